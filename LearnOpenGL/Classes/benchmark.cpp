@@ -0,0 +1,1032 @@
+#include "benchmark.h"
+
+#include "frustumculler.h"
+#include "indirectrenderer.h"
+#include "meshcache.h"
+#include "model.h"
+#include "occlusionculler.h"
+#include "scenebvh.h"
+#include "textureloader.h"
+#include "threadpool.h"
+#include "uniformblocks.h"
+#include "uniformbuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+// heap allocations made by the whole program, read by BenchmarkUniforms. Replacing the global operator new puts an
+// atomic increment on every allocation of the program, so only builds that define BENCHMARK_COUNT_ALLOCATIONS
+// (benchmark builds, never the shipping one) do it
+static std::atomic<unsigned long long> allocationCount(0);
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+namespace
+{
+    // wall-clock milliseconds since start
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // counting trampolines swapped into the glad function pointers while BenchmarkUniforms runs
+    unsigned long long glCallCount = 0;
+    PFNGLGETUNIFORMLOCATIONPROC realGetUniformLocation;
+    PFNGLUNIFORM1IPROC realUniform1i;
+    PFNGLUNIFORM1FPROC realUniform1f;
+    PFNGLUNIFORM3FVPROC realUniform3fv;
+    PFNGLUNIFORMMATRIX3FVPROC realUniformMatrix3fv;
+    PFNGLUNIFORMMATRIX4FVPROC realUniformMatrix4fv;
+    PFNGLBINDBUFFERRANGEPROC realBindBufferRange;
+
+    GLint APIENTRY countGetUniformLocation(GLuint program, const GLchar* name)
+    {
+        glCallCount++;
+        return realGetUniformLocation(program, name);
+    }
+
+    void APIENTRY countUniform1i(GLint location, GLint v0)
+    {
+        glCallCount++;
+        realUniform1i(location, v0);
+    }
+
+    void APIENTRY countUniform1f(GLint location, GLfloat v0)
+    {
+        glCallCount++;
+        realUniform1f(location, v0);
+    }
+
+    void APIENTRY countUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+        glCallCount++;
+        realUniform3fv(location, count, value);
+    }
+
+    void APIENTRY countUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+        glCallCount++;
+        realUniformMatrix3fv(location, count, transpose, value);
+    }
+
+    void APIENTRY countUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+        glCallCount++;
+        realUniformMatrix4fv(location, count, transpose, value);
+    }
+
+    void APIENTRY countBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        glCallCount++;
+        realBindBufferRange(target, index, buffer, offset, size);
+    }
+
+    // draw call and state change counting trampolines swapped in while BenchmarkIndirect runs
+    unsigned long long drawCallCount = 0;
+    unsigned long long textureBindCount = 0;
+    unsigned long long stateChangeCount = 0; // texture, texture unit, sampler uniform, VAO and program changes
+    PFNGLDRAWELEMENTSBASEVERTEXPROC realDrawElementsBaseVertex;
+    PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXPROC realDrawElementsInstancedBaseVertex;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC realMultiDrawElementsIndirect;
+    PFNGLBINDTEXTUREPROC realBindTexture;
+    PFNGLACTIVETEXTUREPROC realActiveTexture;
+    PFNGLBINDVERTEXARRAYPROC realBindVertexArray;
+    PFNGLUSEPROGRAMPROC realUseProgram;
+    PFNGLUNIFORM1IPROC realSamplerUniform1i;
+
+    void APIENTRY countDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex)
+    {
+        drawCallCount++;
+        realDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+    }
+
+    void APIENTRY countDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLint basevertex)
+    {
+        drawCallCount++;
+        realDrawElementsInstancedBaseVertex(mode, count, type, indices, instancecount, basevertex);
+    }
+
+    void APIENTRY countMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride)
+    {
+        drawCallCount++;
+        realMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+    }
+
+    void APIENTRY countBindTexture(GLenum target, GLuint texture)
+    {
+        textureBindCount++;
+        stateChangeCount++;
+        realBindTexture(target, texture);
+    }
+
+    void APIENTRY countActiveTexture(GLenum texture)
+    {
+        stateChangeCount++;
+        realActiveTexture(texture);
+    }
+
+    void APIENTRY countBindVertexArray(GLuint array)
+    {
+        stateChangeCount++;
+        realBindVertexArray(array);
+    }
+
+    void APIENTRY countUseProgram(GLuint program)
+    {
+        stateChangeCount++;
+        realUseProgram(program);
+    }
+
+    void APIENTRY countSamplerUniform1i(GLint location, GLint v0)
+    {
+        stateChangeCount++;
+        realSamplerUniform1i(location, v0);
+    }
+
+    void installDrawCounters(bool install)
+    {
+        if (install)
+        {
+            realDrawElementsBaseVertex = glad_glDrawElementsBaseVertex;
+            realDrawElementsInstancedBaseVertex = glad_glDrawElementsInstancedBaseVertex;
+            realMultiDrawElementsIndirect = glad_glMultiDrawElementsIndirect;
+            realBindTexture = glad_glBindTexture;
+            realActiveTexture = glad_glActiveTexture;
+            realBindVertexArray = glad_glBindVertexArray;
+            realUseProgram = glad_glUseProgram;
+            realSamplerUniform1i = glad_glUniform1i;
+            glad_glDrawElementsBaseVertex = countDrawElementsBaseVertex;
+            glad_glDrawElementsInstancedBaseVertex = countDrawElementsInstancedBaseVertex;
+            glad_glMultiDrawElementsIndirect = countMultiDrawElementsIndirect;
+            glad_glBindTexture = countBindTexture;
+            glad_glActiveTexture = countActiveTexture;
+            glad_glBindVertexArray = countBindVertexArray;
+            glad_glUseProgram = countUseProgram;
+            glad_glUniform1i = countSamplerUniform1i;
+        }
+        else
+        {
+            glad_glDrawElementsBaseVertex = realDrawElementsBaseVertex;
+            glad_glDrawElementsInstancedBaseVertex = realDrawElementsInstancedBaseVertex;
+            glad_glMultiDrawElementsIndirect = realMultiDrawElementsIndirect;
+            glad_glBindTexture = realBindTexture;
+            glad_glActiveTexture = realActiveTexture;
+            glad_glBindVertexArray = realBindVertexArray;
+            glad_glUseProgram = realUseProgram;
+            glad_glUniform1i = realSamplerUniform1i;
+        }
+    }
+
+    void installGLCounters(bool install)
+    {
+        if (install)
+        {
+            realGetUniformLocation = glad_glGetUniformLocation;
+            realUniform1i = glad_glUniform1i;
+            realUniform1f = glad_glUniform1f;
+            realUniform3fv = glad_glUniform3fv;
+            realUniformMatrix3fv = glad_glUniformMatrix3fv;
+            realUniformMatrix4fv = glad_glUniformMatrix4fv;
+            realBindBufferRange = glad_glBindBufferRange;
+            glad_glGetUniformLocation = countGetUniformLocation;
+            glad_glUniform1i = countUniform1i;
+            glad_glUniform1f = countUniform1f;
+            glad_glUniform3fv = countUniform3fv;
+            glad_glUniformMatrix3fv = countUniformMatrix3fv;
+            glad_glUniformMatrix4fv = countUniformMatrix4fv;
+            glad_glBindBufferRange = countBindBufferRange;
+        }
+        else
+        {
+            glad_glGetUniformLocation = realGetUniformLocation;
+            glad_glUniform1i = realUniform1i;
+            glad_glUniform1f = realUniform1f;
+            glad_glUniform3fv = realUniform3fv;
+            glad_glUniformMatrix3fv = realUniformMatrix3fv;
+            glad_glUniformMatrix4fv = realUniformMatrix4fv;
+            glad_glBindBufferRange = realBindBufferRange;
+        }
+    }
+
+    // Frustum::Intersects, FrustumCuller and SceneBvh on boxes inside, straddling and outside each plane of a
+    // known frustum, and SceneBvh::Raycast on a row of boxes. Prints every wrong answer and returns their number
+    unsigned int checkKnownCulling()
+    {
+        // x and y in [-1, 1], z in [-3, -1]
+        Frustum frustum = Frustum::FromMatrix(glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f));
+        struct Case {
+            const char* name;
+            glm::vec3 center;
+            bool visible;
+        };
+        const Case cases[] = {
+            { "inside", { 0.0f, 0.0f, -2.0f }, true },
+            { "straddling left", { -1.0f, 0.0f, -2.0f }, true },
+            { "straddling right", { 1.0f, 0.0f, -2.0f }, true },
+            { "straddling bottom", { 0.0f, -1.0f, -2.0f }, true },
+            { "straddling top", { 0.0f, 1.0f, -2.0f }, true },
+            { "straddling near", { 0.0f, 0.0f, -1.0f }, true },
+            { "straddling far", { 0.0f, 0.0f, -3.0f }, true },
+            { "outside left", { -1.5f, 0.0f, -2.0f }, false },
+            { "outside right", { 1.5f, 0.0f, -2.0f }, false },
+            { "outside bottom", { 0.0f, -1.5f, -2.0f }, false },
+            { "outside top", { 0.0f, 1.5f, -2.0f }, false },
+            { "outside near", { 0.0f, 0.0f, -0.5f }, false },
+            { "outside far", { 0.0f, 0.0f, -3.5f }, false },
+        };
+        const size_t caseCount = sizeof(cases) / sizeof(cases[0]);
+
+        FrustumCuller culler;
+        SceneBvh bvh;
+        for (Case const& box : cases)
+        {
+            BoundingBox bounds;
+            bounds.min = box.center - glm::vec3(0.25f);
+            bounds.max = box.center + glm::vec3(0.25f);
+            culler.Add(bounds);
+            bvh.Insert(bounds);
+        }
+        culler.Cull(frustum);
+        bvh.Build();
+        std::vector<unsigned int> queried;
+        bvh.QueryFrustum(frustum, queried);
+
+        unsigned int failures = 0;
+        for (size_t i = 0; i < caseCount; i++)
+        {
+            bool brute = frustum.Intersects(culler.Box(i));
+            bool bvhVisible = std::find(queried.begin(), queried.end(), static_cast<unsigned int>(i)) != queried.end();
+            if (brute != cases[i].visible || culler.Visible(i) != cases[i].visible || bvhVisible != cases[i].visible)
+            {
+                std::cout << "ERROR::BENCHMARK::CULLING box " << cases[i].name << ": expected " << (cases[i].visible ? "visible" : "culled")
+                    << ", Frustum " << brute << " FrustumCuller " << culler.Visible(i) << " SceneBvh " << bvhVisible << std::endl;
+                failures++;
+            }
+        }
+
+        // unit boxes at z = -5, -10 and off to the side at x = 3: a ray down -z enters the first at distance 4.5,
+        // stopping it at 4 misses everything, and a ray down +z has nothing in front of it
+        SceneBvh row;
+        const glm::vec3 centers[3] = { { 0.0f, 0.0f, -10.0f }, { 0.0f, 0.0f, -5.0f }, { 3.0f, 0.0f, -5.0f } };
+        for (glm::vec3 const& center : centers)
+        {
+            BoundingBox bounds;
+            bounds.min = center - glm::vec3(0.5f);
+            bounds.max = center + glm::vec3(0.5f);
+            row.Insert(bounds);
+        }
+        row.Build();
+        Ray ray;
+        RayHit hit;
+        if (!row.Raycast(ray, hit) || hit.object != 1 || hit.distance != 4.5f)
+        {
+            std::cout << "ERROR::BENCHMARK::CULLING ray: expected object 1 at 4.5, got " << hit.object << " at " << hit.distance << std::endl;
+            failures++;
+        }
+        hit = RayHit();
+        if (row.Raycast(ray, hit, 4.0f))
+        {
+            std::cout << "ERROR::BENCHMARK::CULLING ray: hit object " << hit.object << " beyond maxDistance" << std::endl;
+            failures++;
+        }
+        ray.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+        hit = RayHit();
+        if (row.Raycast(ray, hit))
+        {
+            std::cout << "ERROR::BENCHMARK::CULLING ray: hit object " << hit.object << " behind the origin" << std::endl;
+            failures++;
+        }
+        return failures;
+    }
+}
+
+// compares a cold model load (Assimp import, cache rebuilt) against warm loads served by the mesh cache
+void BenchmarkModelLoad(std::vector<std::string> const& paths, int warmRuns)
+{
+    std::cout << "BENCHMARK::MODEL_LOAD" << std::endl;
+    for (std::string const& path : paths)
+    {
+        // drop the cache so every import has to go through Assimp
+        std::error_code ec;
+        std::filesystem::remove(MeshCache::CachePath(path), ec);
+
+        // the first load decodes and uploads the textures. This model keeps them in the TextureRegistry, so the
+        // timed loads below only compare the Assimp import against the mesh cache
+        auto start = std::chrono::steady_clock::now();
+        Model resident(path);
+        glFinish();
+        double firstMs = elapsedMs(start);
+
+        std::filesystem::remove(MeshCache::CachePath(path), ec);
+        unsigned int hitsBefore = MeshCache::Hits;
+        start = std::chrono::steady_clock::now();
+        {
+            Model cold(path);
+        }
+        double coldMs = elapsedMs(start);
+
+        double warmMs = 0.0;
+        for (int i = 0; i < warmRuns; i++)
+        {
+            start = std::chrono::steady_clock::now();
+            {
+                Model warm(path);
+            }
+            warmMs += elapsedMs(start);
+        }
+        warmMs /= warmRuns > 0 ? warmRuns : 1;
+
+        // textures: what the first load took on top of a cold import
+        char line[512];
+        std::snprintf(line, sizeof(line), "  %-40s cold %9.2f ms   warm %9.2f ms   speedup %6.2fx   (cache hits %u/%d)   textures %9.2f ms",
+            path.c_str(), coldMs, warmMs, warmMs > 0.0 ? coldMs / warmMs : 0.0, MeshCache::Hits - hitsBefore, warmRuns,
+            std::max(firstMs - coldMs, 0.0));
+        std::cout << line << std::endl;
+    }
+    std::cout << "  total cache hits " << MeshCache::Hits << ", misses " << MeshCache::Misses << std::endl;
+}
+
+// decodes every image below the given directories serially and on thread pools of 1..maxThreads workers
+void BenchmarkTextureDecode(std::vector<std::string> const& directories, unsigned int maxThreads)
+{
+    std::vector<std::string> files;
+    for (std::string const& directory : directories)
+    {
+        std::error_code ec;
+        for (auto const& entry : std::filesystem::recursive_directory_iterator(directory, ec))
+        {
+            std::string extension = entry.path().extension().string();
+            if (extension == ".jpg" || extension == ".jpeg" || extension == ".png")
+                files.push_back(entry.path().generic_string());
+        }
+    }
+
+    std::cout << "BENCHMARK::TEXTURE_DECODE " << files.size() << " images" << std::endl;
+
+    // serial baseline, the way Model decodes without a pool
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (std::string const& file : files)
+    {
+        TextureImage image = DecodeTexture(file);
+        bytes += static_cast<size_t>(image.width) * image.height * image.nrComponents;
+    }
+    double serialMs = elapsedMs(start);
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "  serial      %9.2f ms   (%.1f MB decoded)", serialMs, bytes / (1024.0 * 1024.0));
+    std::cout << line << std::endl;
+
+    // powers of two, always finishing on the requested maximum
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads > 0 ? maxThreads : 1);
+
+    for (unsigned int threads : threadCounts)
+    {
+        start = std::chrono::steady_clock::now();
+        {
+            ThreadPool pool(threads);
+            std::vector<std::future<TextureImage>> decoded;
+            for (std::string const& file : files)
+                decoded.push_back(pool.Enqueue([file]() { return DecodeTexture(file); }));
+            for (std::future<TextureImage>& result : decoded)
+                result.get();
+        }
+        double poolMs = elapsedMs(start);
+
+        std::snprintf(line, sizeof(line), "  %2u threads  %9.2f ms   speedup %5.2fx", threads, poolMs, poolMs > 0.0 ? serialMs / poolMs : 0.0);
+        std::cout << line << std::endl;
+    }
+}
+
+// counts GL calls, heap allocations and CPU time of one frame's uniform setup
+void BenchmarkUniforms(Shader& shader, int drawsPerFrame, int frames)
+{
+    const glm::vec3 vec(0.5f);
+    const glm::mat3 mat3(1.0f);
+    const glm::mat4 mat(1.0f);
+    const unsigned int program = shader.ID;
+    const std::string textureTypes[2] = { "texture_diffuse", "texture_specular" };
+
+    // the Camera and Lights blocks, written once per frame into a ring slot as main.cpp does. The same for every
+    // variant, the variants differ in how the uniforms left in the default block are set
+    UniformBufferRing frameUniforms(FRAME_UNIFORMS_SIZE);
+    CameraBlock cameraData;
+    cameraData.view = mat;
+    cameraData.projection = mat;
+    cameraData.viewPos = vec;
+    LightsBlock lightsData = {};
+    lightsData.pointLight.constant = 1.0f;
+    auto writeBlocks = [&]()
+    {
+        unsigned char* frameSlot = frameUniforms.BeginFrame();
+        std::memcpy(frameSlot, &cameraData, sizeof(CameraBlock));
+        std::memcpy(frameSlot + LIGHTS_BLOCK_OFFSET, &lightsData, sizeof(LightsBlock));
+        frameUniforms.BindRange(CAMERA_BLOCK_BINDING, 0, sizeof(CameraBlock));
+        frameUniforms.BindRange(LIGHTS_BLOCK_BINDING, LIGHTS_BLOCK_OFFSET, sizeof(LightsBlock));
+        frameUniforms.EndFrame();
+    };
+
+    // the default block uniforms main.cpp and Mesh::Draw set: per frame the shininess, per draw the model and
+    // normal matrix, the vertex decode uniforms and the material samplers
+    const char* drawVec3Names[] = { "positionOffset", "positionScale" };
+    const char* drawBoolNames[] = { "octahedralNormals", "instanced" };
+
+    // 1. what Shader did before: a glGetUniformLocation per set and sampler names built per draw
+    auto legacyFrame = [&]()
+    {
+        writeBlocks();
+        glUniform1f(glGetUniformLocation(program, std::string("material.shininess").c_str()), 32.0f);
+        for (int draw = 0; draw < drawsPerFrame; draw++)
+        {
+            glUniformMatrix4fv(glGetUniformLocation(program, std::string("model").c_str()), 1, GL_FALSE, &mat[0][0]);
+            glUniformMatrix3fv(glGetUniformLocation(program, std::string("normalMatrix").c_str()), 1, GL_FALSE, &mat3[0][0]);
+            for (const char* name : drawVec3Names)
+                glUniform3fv(glGetUniformLocation(program, std::string(name).c_str()), 1, &vec[0]);
+            for (const char* name : drawBoolNames)
+                glUniform1i(glGetUniformLocation(program, std::string(name).c_str()), 0);
+            for (int i = 0; i < 2; i++)
+                glUniform1i(glGetUniformLocation(program, ("material." + textureTypes[i] + std::to_string(1)).c_str()), i);
+        }
+    };
+
+    // 2. the name based setters, now backed by the reflected location table
+    auto nameFrame = [&]()
+    {
+        writeBlocks();
+        shader.setFloat("material.shininess", 32.0f);
+        for (int draw = 0; draw < drawsPerFrame; draw++)
+        {
+            shader.setMat4("model", mat);
+            shader.setMat3("normalMatrix", mat3);
+            shader.setVec3("positionOffset", vec);
+            shader.setVec3("positionScale", vec);
+            shader.setBool("octahedralNormals", false);
+            shader.setBool("instanced", false);
+            shader.setInt("material.texture_diffuse1", 0);
+            shader.setInt("material.texture_specular1", 1);
+        }
+    };
+
+    // 3. handles resolved once up front, as main.cpp and Mesh::Draw do now
+    UniformHandle shininessHandle = shader.getUniform("material.shininess");
+    UniformHandle modelHandle = shader.getUniform("model");
+    UniformHandle normalMatrixHandle = shader.getUniform("normalMatrix");
+    std::vector<UniformHandle> vec3Handles, boolHandles;
+    for (const char* name : drawVec3Names)
+        vec3Handles.push_back(shader.getUniform(name));
+    for (const char* name : drawBoolNames)
+        boolHandles.push_back(shader.getUniform(name));
+    UniformHandle samplerHandles[2] = { shader.getUniform("material.texture_diffuse1"), shader.getUniform("material.texture_specular1") };
+    auto handleFrame = [&]()
+    {
+        writeBlocks();
+        shader.setFloat(shininessHandle, 32.0f);
+        for (int draw = 0; draw < drawsPerFrame; draw++)
+        {
+            shader.setMat4(modelHandle, mat);
+            shader.setMat3(normalMatrixHandle, mat3);
+            for (UniformHandle uniform : vec3Handles)
+                shader.setVec3(uniform, vec);
+            for (UniformHandle uniform : boolHandles)
+                shader.setBool(uniform, false);
+            shader.setInt(samplerHandles[0], 0);
+            shader.setInt(samplerHandles[1], 1);
+        }
+    };
+
+    // a uniform the shader no longer has would be timed as a no-op, e.g. after it moved into a block
+    std::vector<UniformHandle> allHandles = { shininessHandle, modelHandle, normalMatrixHandle, samplerHandles[0], samplerHandles[1] };
+    allHandles.insert(allHandles.end(), vec3Handles.begin(), vec3Handles.end());
+    allHandles.insert(allHandles.end(), boolHandles.begin(), boolHandles.end());
+    for (UniformHandle uniform : allHandles)
+    {
+        if (uniform.location < 0)
+        {
+            std::cout << "ERROR::BENCHMARK::UNIFORMS: the shader lacks a uniform the benchmark sets" << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "BENCHMARK::UNIFORMS " << drawsPerFrame << " draws per frame, " << frames << " frames" << std::endl;
+#if !defined(BENCHMARK_COUNT_ALLOCATIONS)
+    std::cout << "  allocations are only counted in builds defining BENCHMARK_COUNT_ALLOCATIONS" << std::endl;
+#endif
+    shader.use();
+    installGLCounters(true);
+
+    auto run = [&](const char* label, auto&& frame)
+    {
+        glFinish();
+        glCallCount = 0;
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+        unsigned long long allocationsBefore = allocationCount.load();
+#endif
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+            frame();
+        double ms = elapsedMs(start);
+
+        char allocations[32] = "       -";
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+        std::snprintf(allocations, sizeof(allocations), "%8.1f", double(allocationCount.load() - allocationsBefore) / frames);
+#endif
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-22s %8.1f GL calls/frame %s allocations/frame %9.4f ms/frame",
+            label, double(glCallCount) / frames, allocations, ms / frames);
+        std::cout << line << std::endl;
+    };
+    run("glGetUniformLocation", legacyFrame);
+    run("name lookup", nameFrame);
+    run("handles", handleFrame);
+
+    installGLCounters(false);
+}
+
+// draws instances copies of the models per frame directly and through IndirectRenderer
+void BenchmarkIndirect(std::vector<std::string> const& paths, Shader& directShader, Shader& indirectShader, Shader* bindlessShader, int instances, int frames)
+{
+    std::vector<std::unique_ptr<Model>> models;
+    for (std::string const& path : paths)
+        models.push_back(std::make_unique<Model>(path));
+    if (models.empty())
+        return;
+
+    // square grid of copies in front of the camera, cycling through the models
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(instances))));
+    std::vector<glm::mat4> transforms;
+    for (int i = 0; i < instances; i++)
+    {
+        glm::vec3 position(4.0f * (i % side - side / 2), 4.0f * (i / side - side / 2), -8.0f * side);
+        transforms.push_back(glm::translate(glm::mat4(1.0f), position));
+    }
+
+    // the same copies grouped by model for the instanced draws
+    std::vector<std::vector<glm::mat4>> modelTransforms(models.size());
+    for (size_t i = 0; i < transforms.size(); i++)
+        modelTransforms[i % models.size()].push_back(transforms[i]);
+
+    // static camera and light blocks, the benchmark only measures submission
+    CameraBlock cameraData;
+    cameraData.view = glm::mat4(1.0f);
+    cameraData.projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 1000.0f);
+    cameraData.viewPos = glm::vec3(0.0f);
+    LightsBlock lightsData = {};
+    lightsData.pointLight.constant = 1.0f;
+    unsigned int frameBuffer;
+    glGenBuffers(1, &frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_SIZE, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &cameraData);
+    glBufferSubData(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_OFFSET, sizeof(LightsBlock), &lightsData);
+    glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, frameBuffer, 0, sizeof(CameraBlock));
+    glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, frameBuffer, LIGHTS_BLOCK_OFFSET, sizeof(LightsBlock));
+
+    UniformHandle modelUniform = directShader.getUniform("model");
+    UniformHandle normalMatrixUniform = directShader.getUniform("normalMatrix");
+    IndirectRenderer renderer;
+    IndirectRenderer bindlessRenderer(true);
+
+    std::cout << "BENCHMARK::INDIRECT " << models.size() << " models, " << instances << " instances, " << frames << " frames" << std::endl;
+    installDrawCounters(true);
+
+    // submission is timed on the CPU only, the GPU work of each frame is finished outside the measurement
+    auto run = [&](const char* label, auto&& frame)
+    {
+        glFinish();
+        drawCallCount = 0;
+        textureBindCount = 0;
+        stateChangeCount = 0;
+        double submitMs = 0.0;
+        for (int i = 0; i < frames; i++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            auto start = std::chrono::steady_clock::now();
+            frame();
+            submitMs += elapsedMs(start);
+            glFinish();
+        }
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-22s %9.1f draw calls/frame %9.1f texture binds/frame %9.1f state changes/frame %9.4f ms CPU submit/frame",
+            label, double(drawCallCount) / frames, double(textureBindCount) / frames, double(stateChangeCount) / frames, submitMs / frames);
+        std::cout << line << std::endl;
+    };
+    run("glDrawElements", [&]()
+    {
+        directShader.use();
+        for (size_t i = 0; i < transforms.size(); i++)
+        {
+            directShader.setMat4(modelUniform, transforms[i]);
+            directShader.setMat3(normalMatrixUniform, Shader::NormalMatrix(transforms[i]));
+            models[i % models.size()]->Draw(directShader);
+        }
+    });
+    run("instanced", [&]()
+    {
+        directShader.use();
+        for (size_t m = 0; m < models.size(); m++)
+            models[m]->DrawInstanced(directShader, modelTransforms[m].data(), modelTransforms[m].size());
+    });
+    run("multi draw indirect", [&]()
+    {
+        indirectShader.use();
+        for (size_t i = 0; i < transforms.size(); i++)
+            models[i % models.size()]->Submit(renderer, transforms[i]);
+        renderer.Flush(indirectShader);
+    });
+    std::cout << "  " << renderer.Commands << " commands in " << renderer.DrawCalls << " multi draws" << std::endl;
+
+    if (bindlessShader && bindlessRenderer.UsesBindless())
+    {
+        run("bindless indirect", [&]()
+        {
+            bindlessShader->use();
+            for (size_t i = 0; i < transforms.size(); i++)
+                models[i % models.size()]->Submit(bindlessRenderer, transforms[i]);
+            bindlessRenderer.Flush(*bindlessShader);
+        });
+        std::cout << "  " << bindlessRenderer.Commands << " commands in " << bindlessRenderer.DrawCalls << " multi draws" << std::endl;
+    }
+    else
+        std::cout << "  bindless indirect skipped, GL_ARB_bindless_texture not supported" << std::endl;
+
+    installDrawCounters(false);
+    glDeleteBuffers(1, &frameBuffer);
+}
+
+// GPU time of the vertex stage with the normal matrix from the CPU and computed per vertex
+void BenchmarkNormalMatrix(Shader& shader, Shader& perVertexShader, int segments, int drawsPerFrame, int frames)
+{
+    // UV sphere with segments rings of 2 * segments quads
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    int columns = 2 * segments;
+    for (int ring = 0; ring <= segments; ring++)
+    {
+        float theta = glm::pi<float>() * ring / segments;
+        for (int column = 0; column <= columns; column++)
+        {
+            float phi = 2.0f * glm::pi<float>() * column / columns;
+            glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertices.push_back(Vertex{ normal, normal, glm::vec2(float(column) / columns, float(ring) / segments) });
+        }
+    }
+    for (int ring = 0; ring < segments; ring++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            unsigned int a = ring * (columns + 1) + column;
+            unsigned int b = a + columns + 1;
+            indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+    Mesh sphere(std::move(vertices), std::move(indices), {});
+
+    // a rigid transform takes the fast path of Shader::NormalMatrix, the scaled one the full inverse
+    glm::mat4 rigid = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -4.0f)), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 scaled = glm::scale(rigid, glm::vec3(1.0f, 2.0f, 0.5f));
+
+    std::cout << "BENCHMARK::NORMAL_MATRIX " << vertexCount << " vertices, " << triangleCount << " triangles, "
+        << drawsPerFrame << " draws per frame, " << frames << " frames" << std::endl;
+
+    // only the vertex stage is measured, the fragments would cost the same with both shaders
+    glEnable(GL_RASTERIZER_DISCARD);
+    unsigned int query;
+    glGenQueries(1, &query);
+    auto run = [&](const char* label, Shader& program, glm::mat4 const& model)
+    {
+        program.use();
+        program.setMat4("model", model);
+        program.setMat3("normalMatrix", Shader::NormalMatrix(model));
+
+        // one warm-up frame so shader compilation and first use stay out of the measurement
+        sphere.Draw(program);
+        glFinish();
+
+        double gpuMs = 0.0;
+        double cpuMs = 0.0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            for (int draw = 0; draw < drawsPerFrame; draw++)
+            {
+                // the CPU path recomputes the matrix per draw as a real frame would
+                program.setMat3("normalMatrix", Shader::NormalMatrix(model));
+                sphere.Draw(program);
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            cpuMs += elapsedMs(start);
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            gpuMs += nanoseconds / 1.0e6;
+        }
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-28s %9.4f ms GPU/frame %9.4f ms CPU submit/frame", label, gpuMs / frames, cpuMs / frames);
+        std::cout << line << std::endl;
+    };
+    run("per vertex inverse, rigid", perVertexShader, rigid);
+    run("CPU normal matrix, rigid", shader, rigid);
+    run("per vertex inverse, scaled", perVertexShader, scaled);
+    run("CPU normal matrix, scaled", shader, scaled);
+
+    glDeleteQueries(1, &query);
+    glDisable(GL_RASTERIZER_DISCARD);
+    sphere.Release();
+}
+
+// frustum queries and ray picks over random boxes, brute force against SceneBvh
+bool BenchmarkSceneBvh(std::vector<unsigned int> const& objectCounts, int queries)
+{
+    std::cout << "BENCHMARK::SCENE_BVH " << queries << " frustum queries and rays per object count" << std::endl;
+    unsigned int failures = checkKnownCulling();
+    for (unsigned int objectCount : objectCounts)
+    {
+        // boxes of 0.5 to 2 units at constant density, so deeper scenes hold more objects per query
+        std::mt19937 random(objectCount);
+        float side = 10.0f * std::cbrt(static_cast<float>(objectCount));
+        std::uniform_real_distribution<float> position(-0.5f * side, 0.5f * side);
+        std::uniform_real_distribution<float> size(0.25f, 1.0f);
+        auto randomBox = [&]()
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 extent(size(random), size(random), size(random));
+            BoundingBox box;
+            box.min = center - extent;
+            box.max = center + extent;
+            return box;
+        };
+        std::vector<BoundingBox> boxes(objectCount);
+        for (BoundingBox& box : boxes)
+            box = randomBox();
+
+        // cameras at random spots looking in random directions, a far plane of a quarter of the scene
+        std::vector<Frustum> frustums;
+        std::vector<Ray> rays;
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 0.25f * side);
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        for (int i = 0; i < queries; i++)
+        {
+            glm::vec3 eye(position(random), position(random), position(random));
+            glm::vec3 forward = glm::normalize(glm::vec3(direction(random), direction(random), direction(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+            glm::mat4 view = glm::lookAt(eye, eye + forward, std::abs(forward.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+            frustums.push_back(Frustum::FromMatrix(projection * view));
+            Ray ray;
+            ray.origin = eye;
+            ray.direction = forward;
+            rays.push_back(ray);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        SceneBvh bvh;
+        for (BoundingBox const& box : boxes)
+            bvh.Insert(box);
+        bvh.Build();
+        double buildMs = elapsedMs(start);
+
+        // frustum queries, the visible counts have to agree
+        unsigned long long bruteVisible = 0, cullerVisible = 0, bvhVisible = 0;
+        start = std::chrono::steady_clock::now();
+        for (Frustum const& frustum : frustums)
+            for (BoundingBox const& box : boxes)
+                bruteVisible += frustum.Intersects(box);
+        double bruteMs = elapsedMs(start);
+
+        FrustumCuller culler;
+        for (BoundingBox const& box : boxes)
+            culler.Add(box);
+        start = std::chrono::steady_clock::now();
+        for (Frustum const& frustum : frustums)
+        {
+            culler.Cull(frustum);
+            cullerVisible += culler.Stats.visible;
+        }
+        double cullerMs = elapsedMs(start);
+
+        std::vector<unsigned int> visible;
+        start = std::chrono::steady_clock::now();
+        for (Frustum const& frustum : frustums)
+        {
+            visible.clear();
+            bvh.QueryFrustum(frustum, visible);
+            bvhVisible += visible.size();
+        }
+        double bvhMs = elapsedMs(start);
+
+        // untimed: every box has to get the same answer from all three
+        unsigned int frustumMismatches = 0;
+        std::vector<uint8_t> bvhFlags(objectCount);
+        for (Frustum const& frustum : frustums)
+        {
+            culler.Cull(frustum);
+            visible.clear();
+            bvh.QueryFrustum(frustum, visible);
+            std::fill(bvhFlags.begin(), bvhFlags.end(), 0);
+            for (unsigned int object : visible)
+                bvhFlags[object] = 1;
+            for (unsigned int object = 0; object < objectCount; object++)
+            {
+                bool brute = frustum.Intersects(boxes[object]);
+                frustumMismatches += brute != culler.Visible(object) || brute != (bvhFlags[object] != 0);
+            }
+        }
+
+        // nearest hit per ray
+        unsigned int rayMismatches = 0;
+        std::vector<RayHit> bruteHits(rays.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            float distance;
+            for (unsigned int object = 0; object < objectCount; object++)
+            {
+                if (IntersectRay(rays[i], boxes[object], bruteHits[i].distance, distance) && distance < bruteHits[i].distance)
+                {
+                    bruteHits[i].object = object;
+                    bruteHits[i].distance = distance;
+                }
+            }
+        }
+        double bruteRayMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            RayHit hit;
+            bvh.Raycast(rays[i], hit);
+            if (hit.distance != bruteHits[i].distance)
+                rayMismatches++;
+        }
+        double bvhRayMs = elapsedMs(start);
+
+        // a tenth of the objects move a little, as animated objects would in one frame
+        std::uniform_int_distribution<unsigned int> pick(0, objectCount - 1);
+        std::uniform_real_distribution<float> nudge(-1.0f, 1.0f);
+        start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < objectCount / 10; i++)
+        {
+            unsigned int object = pick(random);
+            glm::vec3 offset(nudge(random), nudge(random), nudge(random));
+            BoundingBox box = bvh.Bounds(object);
+            box.min += offset;
+            box.max += offset;
+            bvh.Update(object, box);
+        }
+        bvh.Refit();
+        double refitMs = elapsedMs(start);
+        SceneBvhStats stats = bvh.Stats();
+
+        char line[256];
+        std::cout << "  " << objectCount << " objects: build " << buildMs << " ms, " << stats.nodes << " nodes, depth "
+            << stats.depth << ", refit of " << objectCount / 10 << " moved objects " << refitMs << " ms" << std::endl;
+        std::snprintf(line, sizeof(line), "    frustum  brute force %9.4f ms  FrustumCuller (%s) %9.4f ms  SceneBvh %9.4f ms per query, %.1f visible%s",
+            bruteMs / queries, FrustumCuller::InstructionSet(), cullerMs / queries, bvhMs / queries, double(bvhVisible) / queries,
+            frustumMismatches == 0 && bruteVisible == bvhVisible && cullerVisible == bvhVisible ? "" : " (MISMATCH)");
+        std::cout << line << std::endl;
+        std::snprintf(line, sizeof(line), "    ray      brute force %9.4f ms  SceneBvh %9.4f ms per ray%s",
+            bruteRayMs / queries, bvhRayMs / queries, rayMismatches == 0 ? "" : " (MISMATCH)");
+        std::cout << line << std::endl;
+        failures += frustumMismatches + (bruteVisible != bvhVisible) + (cullerVisible != bvhVisible) + rayMismatches;
+    }
+    if (failures > 0)
+        std::cout << "ERROR::BENCHMARK::SCENE_BVH " << failures << " wrong results" << std::endl;
+    return failures == 0;
+}
+
+// software occlusion culling of a fixed scene
+bool BenchmarkOcclusion(int frames)
+{
+    // the camera looks down -z from eye height at a 12 x 4 wall 10 units away
+    glm::vec3 eye(0.0f, 1.5f, 0.0f);
+    glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+        * glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::vec3 wall[4] = { { -6.0f, 0.0f, -10.0f }, { 6.0f, 0.0f, -10.0f }, { 6.0f, 4.0f, -10.0f }, { -6.0f, 4.0f, -10.0f } };
+    const unsigned int wallIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    // half unit boxes on the ground, in front of, beside and behind the wall
+    std::vector<BoundingBox> boxes;
+    for (int z = 0; z < 30; z++)
+    {
+        for (int x = -15; x <= 15; x++)
+        {
+            BoundingBox box;
+            box.min = glm::vec3(x - 0.25f, 0.0f, -2.0f - z);
+            box.max = glm::vec3(x + 0.25f, 0.5f, -1.5f - z);
+            boxes.push_back(box);
+        }
+    }
+
+    // reference: a box is hidden exactly when the lines of sight to all of its corners pass through the wall
+    unsigned int exactlyHidden = 0;
+    std::vector<bool> hidden(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        bool allBehind = true;
+        for (int corner = 0; corner < 8 && allBehind; corner++)
+        {
+            glm::vec3 position((corner & 1) ? boxes[i].max.x : boxes[i].min.x, (corner & 2) ? boxes[i].max.y : boxes[i].min.y, (corner & 4) ? boxes[i].max.z : boxes[i].min.z);
+            float t = (wall[0].z - eye.z) / (position.z - eye.z);
+            glm::vec3 crossing = eye + t * (position - eye);
+            allBehind = t > 0.0f && t < 1.0f && crossing.x >= wall[0].x && crossing.x <= wall[1].x && crossing.y >= wall[0].y && crossing.y <= wall[2].y;
+        }
+        hidden[i] = allBehind;
+        exactlyHidden += allBehind;
+    }
+
+    OcclusionCuller occlusion;
+    unsigned int wrong = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        occlusion.Begin(viewProjection);
+        occlusion.RasterizeOccluder(wall, sizeof(glm::vec3), wallIndices, 6, glm::mat4(1.0f));
+        occlusion.Finish();
+        for (size_t i = 0; i < boxes.size(); i++)
+            if (!occlusion.Visible(boxes[i]) && !hidden[i])
+                wrong++;
+    }
+    double ms = elapsedMs(start);
+
+    // FNV-1a over the depth buffer bits
+    uint64_t checksum = 14695981039346656037ull;
+    const float* depth = occlusion.DepthBuffer();
+    for (int i = 0; i < occlusion.Width() * occlusion.Height(); i++)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &depth[i], sizeof(bits));
+        checksum = (checksum ^ bits) * 1099511628211ull;
+    }
+
+    char line[256];
+    std::cout << "BENCHMARK::OCCLUSION " << occlusion.Width() << "x" << occlusion.Height() << " depth buffer, "
+        << boxes.size() << " boxes, " << frames << " frames" << std::endl;
+    std::snprintf(line, sizeof(line), "  %u occluded (%u exactly hidden), %u wrongly occluded, depth checksum %016llx, %.4f ms/frame",
+        occlusion.Stats.occluded, exactlyHidden, wrong, static_cast<unsigned long long>(checksum), ms / frames);
+    std::cout << line << std::endl;
+
+    // boxes with a known answer: between the eye and the wall, right behind its middle, and behind it but tall
+    // enough to be seen over its top edge
+    struct Case {
+        const char* name;
+        glm::vec3 min;
+        glm::vec3 max;
+        bool visible;
+    };
+    const Case cases[] = {
+        { "in front of the wall", { -0.5f, 0.5f, -6.0f }, { 0.5f, 1.5f, -5.0f }, true },
+        { "behind the wall", { -1.0f, 0.5f, -16.0f }, { 1.0f, 2.0f, -14.0f }, false },
+        { "above the wall", { -0.5f, 6.0f, -21.0f }, { 0.5f, 8.0f, -20.0f }, true },
+    };
+    unsigned int failures = wrong;
+    for (Case const& test : cases)
+    {
+        BoundingBox box;
+        box.min = test.min;
+        box.max = test.max;
+        if (occlusion.Visible(box) != test.visible)
+        {
+            std::cout << "ERROR::BENCHMARK::OCCLUSION box " << test.name << " reported " << (test.visible ? "occluded" : "visible") << std::endl;
+            failures++;
+        }
+    }
+    if (wrong > 0)
+        std::cout << "ERROR::BENCHMARK::OCCLUSION " << wrong << " boxes occluded that are not hidden" << std::endl;
+    return failures == 0;
+}
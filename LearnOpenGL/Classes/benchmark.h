@@ -0,0 +1,51 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "shader.h"
+
+#include <string>
+#include <vector>
+
+// Benchmarks are started from the command line (see main.cpp) and print their results to stdout.
+// Unless noted otherwise they expect a current OpenGL context.
+
+// compares a cold model load (Assimp import, cache rebuilt) against warm loads served by the mesh cache. The
+// textures stay resident across the timed loads, their decode and upload time is reported separately
+void BenchmarkModelLoad(std::vector<std::string> const& paths, int warmRuns);
+
+// decodes every image below the given directories serially and on thread pools of 1..maxThreads workers.
+// Needs no OpenGL context
+void BenchmarkTextureDecode(std::vector<std::string> const& directories, unsigned int maxThreads);
+
+// counts GL calls, heap allocations and CPU time of one frame's uniform setup: the Camera and Lights blocks
+// written into a UniformBufferRing slot, plus the default block uniforms of drawsPerFrame meshes (model and normal
+// matrix, vertex decode uniforms, material samplers) set with per-call name lookups, the name setters and handles.
+// Heap allocations are only counted in builds that define BENCHMARK_COUNT_ALLOCATIONS, which replaces the global
+// operator new
+void BenchmarkUniforms(Shader& shader, int drawsPerFrame, int frames);
+
+// draws instances copies of the models per frame, once with a glDrawElements per mesh (directShader, shader.vert),
+// once with one instanced draw per mesh, once through IndirectRenderer (indirectShader, indirect.vert) and, if
+// bindlessShader is given and the extension is present, through a bindless IndirectRenderer. Compares draw calls,
+// state changes and CPU submit time
+void BenchmarkIndirect(std::vector<std::string> const& paths, Shader& directShader, Shader& indirectShader, Shader* bindlessShader, int instances, int frames);
+
+// GPU time (GL_TIME_ELAPSED queries) of the vertex stage on a procedural sphere of 4 * segments^2
+// triangles, drawn drawsPerFrame times per frame with rasterization discarded. shader uses the CPU normal matrix,
+// perVertexShader is shader.vert built with PER_VERTEX_NORMAL_MATRIX and inverts the model matrix per vertex
+void BenchmarkNormalMatrix(Shader& shader, Shader& perVertexShader, int segments, int drawsPerFrame, int frames);
+
+// frustum queries and ray picks over random boxes: brute force over every box, the SIMD FrustumCuller and a
+// SceneBvh, once per object count. Also times Build and a Refit after moving a tenth of the boxes. Checks first
+// that all three agree with known answers (boxes inside, straddling and outside each frustum plane, rays against
+// a row of boxes), then that they agree with each other box by box. Returns false on any wrong or differing
+// answer. Needs no OpenGL context
+bool BenchmarkSceneBvh(std::vector<unsigned int> const& objectCounts, int queries);
+
+// software occlusion culling of a fixed scene: a wall in front of a grid of boxes on the ground. Checks that no
+// box is reported occluded that is not entirely behind the wall and that boxes in front of, behind and above the
+// wall get the known answer, prints the depth buffer checksum (equal on every run) and the CPU time per frame.
+// Returns false on any wrong answer. Needs no OpenGL context
+bool BenchmarkOcclusion(int frames);
+
+#endif
@@ -0,0 +1,79 @@
+#include "bindlesstextures.h"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+    typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+    typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+    PFNGLGETTEXTUREHANDLEARBPROC getTextureHandle = nullptr;
+    PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeTextureHandleResident = nullptr;
+    PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeTextureHandleNonResident = nullptr;
+    bool supported = false;
+
+    // texture ID -> resident handle
+    std::unordered_map<unsigned int, GLuint64> handles;
+}
+
+// true if the current context exposes the extension
+bool HasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// loads the extension if the context exposes it
+bool LoadBindlessTextures(GLADloadproc load)
+{
+    if (!HasExtension("GL_ARB_bindless_texture"))
+        return false;
+
+    getTextureHandle = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(load("glGetTextureHandleARB"));
+    makeTextureHandleResident = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(load("glMakeTextureHandleResidentARB"));
+    makeTextureHandleNonResident = reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(load("glMakeTextureHandleNonResidentARB"));
+    supported = getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident;
+    return supported;
+}
+
+// true once LoadBindlessTextures succeeded
+bool BindlessTexturesSupported()
+{
+    return supported;
+}
+
+// resident bindless handle of a texture
+GLuint64 TextureHandle(unsigned int textureID)
+{
+    auto found = handles.find(textureID);
+    if (found != handles.end())
+        return found->second;
+
+    // a failed lookup (e.g. a texture without storage yet) is not cached, so a later call can still succeed
+    GLuint64 handle = getTextureHandle(textureID);
+    if (handle == 0)
+        return 0;
+    makeTextureHandleResident(handle);
+    handles[textureID] = handle;
+    return handle;
+}
+
+// makes the handle of a texture non-resident
+void ReleaseTextureHandle(unsigned int textureID)
+{
+    auto found = handles.find(textureID);
+    if (found == handles.end())
+        return;
+
+    makeTextureHandleNonResident(found->second);
+    handles.erase(found);
+}
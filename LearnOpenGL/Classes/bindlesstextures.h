@@ -0,0 +1,25 @@
+#ifndef BINDLESSTEXTURES_H
+#define BINDLESSTEXTURES_H
+
+#include <glad/glad.h>
+
+// ARB_bindless_texture support. glad is generated without extensions, so the entry points are loaded here
+// through the same loader glad used. Handles are created on first use, made resident and cached per texture.
+
+// true if the current context exposes the extension, glad does not track them
+bool HasExtension(const char* name);
+
+// loads the extension if the context exposes it, returns false otherwise. Call once after gladLoadGLLoader
+bool LoadBindlessTextures(GLADloadproc load);
+
+// true once LoadBindlessTextures succeeded
+bool BindlessTexturesSupported();
+
+// resident bindless handle of a texture, 0 if it has no storage yet. The texture's storage and sampling state
+// must not change afterwards
+GLuint64 TextureHandle(unsigned int textureID);
+
+// makes the handle of a texture non-resident, has to happen before the texture is deleted
+void ReleaseTextureHandle(unsigned int textureID);
+
+#endif
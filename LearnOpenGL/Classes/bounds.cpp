@@ -0,0 +1,184 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // position i of a strided array
+    glm::vec3 const& positionAt(const glm::vec3* first, size_t i, size_t stride)
+    {
+        return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const unsigned char*>(first) + i * stride);
+    }
+}
+
+// Gribb/Hartmann extraction: every plane is the sum or difference of the fourth row and one other row
+Frustum Frustum::FromMatrix(glm::mat4 const& matrix)
+{
+    // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::mat4 rows = glm::transpose(matrix);
+
+    Frustum frustum;
+    frustum.planes[PLANE_LEFT] = rows[3] + rows[0];
+    frustum.planes[PLANE_RIGHT] = rows[3] - rows[0];
+    frustum.planes[PLANE_BOTTOM] = rows[3] + rows[1];
+    frustum.planes[PLANE_TOP] = rows[3] - rows[1];
+    frustum.planes[PLANE_NEAR] = rows[3] + rows[2];
+    frustum.planes[PLANE_FAR] = rows[3] - rows[2];
+
+    // normalized, so plane distances are real distances and spheres can be tested against them
+    for (glm::vec4& plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+    return frustum;
+}
+
+// false only if the box is entirely outside one plane
+bool Frustum::Intersects(BoundingBox const& box) const
+{
+    if (box.min.x > box.max.x)
+        return false;
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extent = 0.5f * (box.max - box.min);
+    for (glm::vec4 const& plane : planes)
+    {
+        // the box corner furthest along the normal is inside if the center is within the projected extent
+        glm::vec3 normal(plane);
+        if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+// false only if the sphere is entirely outside one plane
+bool Frustum::Intersects(BoundingSphere const& sphere) const
+{
+    for (glm::vec4 const& plane : planes)
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    return true;
+}
+
+// box around positions
+BoundingBox ComputeBoundingBox(const glm::vec3* first, size_t count, size_t stride)
+{
+    BoundingBox box;
+    if (count == 0)
+        return box;
+    box.min = box.max = positionAt(first, 0, stride);
+    for (size_t i = 1; i < count; i++)
+    {
+        glm::vec3 const& position = positionAt(first, i, stride);
+        box.min = glm::min(box.min, position);
+        box.max = glm::max(box.max, position);
+    }
+    return box;
+}
+
+// sphere around positions, centered on their box. Not minimal, but one pass and deterministic
+BoundingSphere ComputeBoundingSphere(const glm::vec3* first, size_t count, size_t stride)
+{
+    BoundingSphere sphere;
+    if (count == 0)
+        return sphere;
+    BoundingBox box = ComputeBoundingBox(first, count, stride);
+    sphere.center = 0.5f * (box.min + box.max);
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 offset = positionAt(first, i, stride) - sphere.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    sphere.radius = std::sqrt(radiusSquared);
+    return sphere;
+}
+
+// smallest box containing both
+BoundingBox Union(BoundingBox const& a, BoundingBox const& b)
+{
+    if (a.min.x > a.max.x)
+        return b;
+    if (b.min.x > b.max.x)
+        return a;
+    BoundingBox box;
+    box.min = glm::min(a.min, b.min);
+    box.max = glm::max(a.max, b.max);
+    return box;
+}
+
+// box around the transformed box (Arvo)
+BoundingBox TransformBox(BoundingBox const& box, glm::mat4 const& transform)
+{
+    if (box.min.x > box.max.x)
+        return box;
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extent = 0.5f * (box.max - box.min);
+
+    // the new half extent along each axis is the absolute linear part applied to the old one
+    glm::mat3 linear(transform);
+    glm::mat3 absolute(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+    glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+    glm::vec3 newExtent = absolute * extent;
+
+    BoundingBox result;
+    result.min = newCenter - newExtent;
+    result.max = newCenter + newExtent;
+    return result;
+}
+
+// sphere around the transformed sphere
+BoundingSphere TransformSphere(BoundingSphere const& sphere, glm::mat4 const& transform)
+{
+    glm::mat3 linear(transform);
+    float scale = std::sqrt(std::max({ glm::dot(linear[0], linear[0]), glm::dot(linear[1], linear[1]), glm::dot(linear[2], linear[2]) }));
+
+    BoundingSphere result;
+    result.center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+    result.radius = sphere.radius * scale;
+    return result;
+}
+
+// surface area of the box
+float SurfaceArea(BoundingBox const& box)
+{
+    if (box.min.x > box.max.x)
+        return 0.0f;
+    glm::vec3 size = box.max - box.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// slab test against the box
+bool IntersectRay(Ray const& ray, BoundingBox const& box, float maxDistance, float& distance)
+{
+    if (box.min.x > box.max.x)
+        return false;
+
+    // 1 / 0 is infinite, which keeps axis parallel rays working without a branch
+    glm::vec3 inverse = 1.0f / ray.direction;
+    glm::vec3 t0 = (box.min - ray.origin) * inverse;
+    glm::vec3 t1 = (box.max - ray.origin) * inverse;
+    glm::vec3 slabEnter = glm::min(t0, t1);
+    glm::vec3 slabExit = glm::max(t0, t1);
+    float enter = std::max(std::max(slabEnter.x, slabEnter.y), std::max(slabEnter.z, 0.0f));
+    float exit = std::min(std::min(slabExit.x, slabExit.y), std::min(slabExit.z, maxDistance));
+    if (enter > exit)
+        return false;
+    distance = enter;
+    return true;
+}
+
+// world space ray through a point in normalized device coordinates
+Ray ScreenRay(glm::vec2 const& ndc, glm::mat4 const& viewProjection)
+{
+    glm::mat4 inverse = glm::inverse(viewProjection);
+    glm::vec4 nearPoint = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+
+    Ray ray;
+    ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+    return ray;
+}
@@ -0,0 +1,64 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// axis aligned bounding box. An empty box has min > max
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(1.0f);
+    glm::vec3 max = glm::vec3(-1.0f);
+};
+
+// bounding sphere, used where a size or distance estimate is enough
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// half line origin + t * direction, t >= 0
+struct Ray {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+};
+
+// six planes (xyz: inward normal, w: distance) of a view frustum, in the space the matrix it was extracted from
+// maps to clip space. A point p is inside a plane if dot(plane.xyz, p) + plane.w >= 0
+struct Frustum {
+    enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+    glm::vec4 planes[PLANE_COUNT];
+
+    // Gribb/Hartmann extraction from an OpenGL (-w..w clip depth) matrix. projection * view gives world
+    // space planes, projection * view * model the planes in that model's space
+    static Frustum FromMatrix(glm::mat4 const& matrix);
+
+    // false only if the volume is entirely outside one plane. Conservative near the frustum corners
+    bool Intersects(BoundingBox const& box) const;
+    bool Intersects(BoundingSphere const& sphere) const;
+};
+
+// box and sphere around positions, read count times with the given byte stride starting at first
+BoundingBox ComputeBoundingBox(const glm::vec3* first, size_t count, size_t stride = sizeof(glm::vec3));
+BoundingSphere ComputeBoundingSphere(const glm::vec3* first, size_t count, size_t stride = sizeof(glm::vec3));
+
+// smallest box containing both
+BoundingBox Union(BoundingBox const& a, BoundingBox const& b);
+
+// box around the transformed box (Arvo), tight for rotations and scales of an axis aligned box
+BoundingBox TransformBox(BoundingBox const& box, glm::mat4 const& transform);
+
+// sphere around the transformed sphere, the radius grows with the largest axis scale
+BoundingSphere TransformSphere(BoundingSphere const& sphere, glm::mat4 const& transform);
+
+// surface area of the box, 0 for an empty one
+float SurfaceArea(BoundingBox const& box);
+
+// slab test. distance is where the ray enters the box, 0 if it starts inside. False if it misses or enters
+// beyond maxDistance
+bool IntersectRay(Ray const& ray, BoundingBox const& box, float maxDistance, float& distance);
+
+// world space ray through a point in normalized device coordinates (-1..1, y up), from the near plane on
+Ray ScreenRay(glm::vec2 const& ndc, glm::mat4 const& viewProjection);
+
+#endif
@@ -21,6 +21,24 @@ glm::mat4 Camera::GetViewMatrix()
     return glm::lookAt(Position, Position + Front, Up);
 }
 
+// returns the world space frustum seen through projection from the current view
+Frustum Camera::GetFrustum(glm::mat4 const& projection)
+{
+    return Frustum::FromMatrix(projection * GetViewMatrix());
+}
+
+// returns the world space ray through a point in normalized device coordinates
+Ray Camera::GetRay(glm::vec2 const& ndc, glm::mat4 const& projection)
+{
+    return ScreenRay(ndc, projection * GetViewMatrix());
+}
+
+// returns how many pixels one world unit covers at distance 1
+float Camera::PixelsPerUnit(float viewportHeight) const
+{
+    return viewportHeight / (2.0f * std::tan(glm::radians(fov) * 0.5f));
+}
+
 // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 {
@@ -71,6 +89,14 @@ void Camera::ProcessMouseScroll(float yoffset)
         fov = 45.0f;
 }
 
+// sets the Euler angles (degrees) directly
+void Camera::SetOrientation(float yaw, float pitch)
+{
+    Yaw = yaw;
+    Pitch = pitch;
+    updateCameraVectors();
+}
+
 // calculates the front vector from the Camera's (updated) Euler Angles
 void Camera::updateCameraVectors()
 {
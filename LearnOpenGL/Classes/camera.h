@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "bounds.h"
+
 #include <vector>
 
 enum Camera_Movement
@@ -49,6 +51,15 @@ public:
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
     glm::mat4 GetViewMatrix();
 
+    // returns the world space frustum seen through projection from the current view
+    Frustum GetFrustum(glm::mat4 const& projection);
+
+    // returns the world space ray through a point in normalized device coordinates (-1..1, y up)
+    Ray GetRay(glm::vec2 const& ndc, glm::mat4 const& projection);
+
+    // returns how many pixels one world unit covers at distance 1 on a viewport viewportHeight pixels high
+    float PixelsPerUnit(float viewportHeight) const;
+
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 
@@ -58,6 +69,9 @@ public:
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset);
 
+    // sets the Euler angles (degrees) directly, e.g. from a recorded camera path
+    void SetOrientation(float yaw, float pitch);
+
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
 	void updateCameraVectors();
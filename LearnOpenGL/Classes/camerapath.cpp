@@ -0,0 +1,149 @@
+#include "camerapath.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    // uniform Catmull-Rom segment from p1 (t = 0) to p2 (t = 1)
+    glm::vec3 catmullRom(glm::vec3 const& p0, glm::vec3 const& p1, glm::vec3 const& p2, glm::vec3 const& p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+            + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+}
+
+// reads a path file
+bool CameraPath::Load(std::string const& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::CAMERA_PATH::FILE_NOT_READ " << path << std::endl;
+        return false;
+    }
+
+    Keyframes.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        CameraKeyframe key;
+        if (!(fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.fov))
+        {
+            std::cout << "ERROR::CAMERA_PATH::BAD_KEYFRAME " << path << ":" << lineNumber << std::endl;
+            return false;
+        }
+        Keyframes.push_back(key);
+    }
+    std::stable_sort(Keyframes.begin(), Keyframes.end(), [](CameraKeyframe const& a, CameraKeyframe const& b) { return a.time < b.time; });
+
+    if (Keyframes.empty())
+    {
+        std::cout << "ERROR::CAMERA_PATH::NO_KEYFRAMES " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// writes the keyframes in the format Load reads
+bool CameraPath::Save(std::string const& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::CAMERA_PATH::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    file << "# time x y z yaw pitch fov\n";
+    for (CameraKeyframe const& key : Keyframes)
+        file << key.time << ' ' << key.position.x << ' ' << key.position.y << ' ' << key.position.z << ' '
+            << key.yaw << ' ' << key.pitch << ' ' << key.fov << '\n';
+    return static_cast<bool>(file);
+}
+
+// a full circle of radius around center at height above it, always looking at center
+CameraPath CameraPath::Orbit(glm::vec3 const& center, float radius, float height, float seconds)
+{
+    // 16 segments are close enough to a circle with the spline through them
+    const int SEGMENTS = 16;
+    float pitch = glm::degrees(std::atan2(-height, radius));
+
+    CameraPath path;
+    for (int i = 0; i <= SEGMENTS; i++)
+    {
+        float angle = glm::two_pi<float>() * i / SEGMENTS;
+        CameraKeyframe key;
+        key.time = seconds * i / SEGMENTS;
+        key.position = center + glm::vec3(radius * std::cos(angle), height, radius * std::sin(angle));
+        // Front points from the position back to the center; growing the yaw with the angle keeps it unwrapped
+        key.yaw = glm::degrees(angle) + 180.0f;
+        key.pitch = pitch;
+        key.fov = FOV;
+        path.Keyframes.push_back(key);
+    }
+    return path;
+}
+
+// appends the camera's current state at time
+void CameraPath::Record(Camera const& camera, float time)
+{
+    Keyframes.push_back(CameraKeyframe{ time, camera.Position, camera.Yaw, camera.Pitch, camera.fov });
+}
+
+// moves camera to where the path is at time, clamped to the first and last keyframe
+void CameraPath::Apply(Camera& camera, float time) const
+{
+    if (Keyframes.empty())
+        return;
+
+    // segment [i, i + 1] containing time
+    auto next = std::upper_bound(Keyframes.begin(), Keyframes.end(), time,
+        [](float t, CameraKeyframe const& key) { return t < key.time; });
+    CameraKeyframe const* key;
+    CameraKeyframe blended;
+    if (next == Keyframes.begin())
+        key = &Keyframes.front();
+    else if (next == Keyframes.end())
+        key = &Keyframes.back();
+    else
+    {
+        size_t i = (next - Keyframes.begin()) - 1;
+        CameraKeyframe const& a = Keyframes[i];
+        CameraKeyframe const& b = Keyframes[i + 1];
+        CameraKeyframe const& before = Keyframes[i > 0 ? i - 1 : i];
+        CameraKeyframe const& after = Keyframes[std::min(i + 2, Keyframes.size() - 1)];
+        float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 0.0f;
+
+        blended.time = time;
+        blended.position = catmullRom(before.position, a.position, b.position, after.position, t);
+        blended.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        blended.pitch = a.pitch + (b.pitch - a.pitch) * t;
+        blended.fov = a.fov + (b.fov - a.fov) * t;
+        key = &blended;
+    }
+
+    camera.Position = key->position;
+    camera.fov = key->fov;
+    camera.SetOrientation(key->yaw, key->pitch);
+}
+
+// time of the last keyframe
+float CameraPath::Duration() const
+{
+    return Keyframes.empty() ? 0.0f : Keyframes.back().time;
+}
@@ -0,0 +1,49 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+#include <string>
+#include <vector>
+
+// camera state at a point in time, angles in degrees as Camera keeps them
+struct CameraKeyframe {
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float fov;
+};
+
+// Timed camera keyframes, recorded from a flight through the scene or scripted, replayed by setting the Camera
+// directly instead of going through keyboard and mouse input. Positions follow a Catmull-Rom spline through the
+// keyframes, angles and field of view are interpolated linearly. Files hold one keyframe per line,
+// "time x y z yaw pitch fov", lines starting with # are comments.
+class CameraPath
+{
+public:
+    // keyframes sorted by time
+    std::vector<CameraKeyframe> Keyframes;
+
+    // reads a path file, false if it cannot be read or holds no keyframe
+    bool Load(std::string const& path);
+
+    // writes the keyframes in the format Load reads
+    bool Save(std::string const& path) const;
+
+    // a full circle of radius around center at height above it in the given time, always looking at center
+    static CameraPath Orbit(glm::vec3 const& center, float radius, float height, float seconds);
+
+    // appends the camera's current state at time, which has to be later than the last keyframe
+    void Record(Camera const& camera, float time);
+
+    // moves camera to where the path is at time, clamped to the first and last keyframe
+    void Apply(Camera& camera, float time) const;
+
+    // time of the last keyframe
+    float Duration() const;
+};
+
+#endif
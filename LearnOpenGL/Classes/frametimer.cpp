@@ -0,0 +1,149 @@
+#include "frametimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    // nearest-rank percentile of sorted values, p in (0, 1]
+    double percentile(std::vector<double> const& sorted, double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    // {"min": ..., ...} of a summary
+    void writeStats(std::ofstream& file, FrameTimeStats const& stats)
+    {
+        file << "{\"min\": " << stats.min << ", \"median\": " << stats.median << ", \"p95\": " << stats.p95
+            << ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << ", \"mean\": " << stats.mean << "}";
+    }
+
+    // [...] of a series
+    void writeSeries(std::ofstream& file, std::vector<double> const& values)
+    {
+        file << "[";
+        for (size_t i = 0; i < values.size(); i++)
+            file << (i > 0 ? ", " : "") << values[i];
+        file << "]";
+    }
+
+    // JSON string contents
+    std::string escape(std::string const& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+}
+
+// constructor
+FrameTimer::FrameTimer()
+{
+    glGenQueries(FRAME_TIMER_LATENCY, queries);
+    frames = 0;
+}
+
+// deletes the queries
+FrameTimer::~FrameTimer()
+{
+    glDeleteQueries(FRAME_TIMER_LATENCY, queries);
+}
+
+// brackets the work of one frame
+void FrameTimer::Begin()
+{
+    // the query this frame reuses belongs to the frame FRAME_TIMER_LATENCY ago
+    if (frames >= FRAME_TIMER_LATENCY)
+        readGpuTime(frames - FRAME_TIMER_LATENCY);
+    glBeginQuery(GL_TIME_ELAPSED, queries[frames % FRAME_TIMER_LATENCY]);
+    frameStart = std::chrono::steady_clock::now();
+}
+
+void FrameTimer::End()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    cpuMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+    frames++;
+}
+
+// waits for the queries still in flight
+void FrameTimer::Finish()
+{
+    for (size_t frame = gpuMs.size(); frame < frames; frame++)
+        readGpuTime(frame);
+}
+
+// one entry per timed frame
+std::vector<double> const& FrameTimer::CpuMs() const
+{
+    return cpuMs;
+}
+
+std::vector<double> const& FrameTimer::GpuMs() const
+{
+    return gpuMs;
+}
+
+// min, nearest-rank median and percentiles, max and mean of values
+FrameTimeStats FrameTimer::Summarize(std::vector<double> values)
+{
+    FrameTimeStats stats = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    if (values.empty())
+        return stats;
+
+    std::sort(values.begin(), values.end());
+    stats.min = values.front();
+    stats.median = percentile(values, 0.5);
+    stats.p95 = percentile(values, 0.95);
+    stats.p99 = percentile(values, 0.99);
+    stats.max = values.back();
+    for (double value : values)
+        stats.mean += value;
+    stats.mean /= values.size();
+    return stats;
+}
+
+// writes the frame count, timestep, both summaries and the per-frame times as JSON
+bool FrameTimer::WriteJson(std::string const& path, std::string const& name, std::string const& options, float timestep) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::FRAME_TIMER::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    file << "{\n";
+    file << "  \"name\": \"" << escape(name) << "\",\n";
+    file << "  \"options\": \"" << escape(options) << "\",\n";
+    file << "  \"renderer\": \"" << escape(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) << "\",\n";
+    file << "  \"frames\": " << cpuMs.size() << ",\n";
+    file << "  \"timestep\": " << timestep << ",\n";
+    file << "  \"cpu_ms\": ";
+    writeStats(file, Summarize(cpuMs));
+    file << ",\n  \"gpu_ms\": ";
+    writeStats(file, Summarize(gpuMs));
+    file << ",\n  \"frame_cpu_ms\": ";
+    writeSeries(file, cpuMs);
+    file << ",\n  \"frame_gpu_ms\": ";
+    writeSeries(file, gpuMs);
+    file << "\n}\n";
+    return static_cast<bool>(file);
+}
+
+// reads the GPU time of frame into gpuMs, waiting for it if needed
+void FrameTimer::readGpuTime(size_t frame)
+{
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(queries[frame % FRAME_TIMER_LATENCY], GL_QUERY_RESULT, &nanoseconds);
+    gpuMs.push_back(nanoseconds / 1.0e6);
+}
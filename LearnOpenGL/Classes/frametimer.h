@@ -0,0 +1,67 @@
+#ifndef FRAMETIMER_H
+#define FRAMETIMER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// frames a GPU time query is read back after, so the read never waits for the GPU
+const unsigned int FRAME_TIMER_LATENCY = 4;
+
+// distribution of one series of frame times, in milliseconds
+struct FrameTimeStats {
+    double min;
+    double median;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+};
+
+// Per-frame CPU and GPU times of a benchmark run. The CPU time is the wall-clock time from Begin to End, the GPU
+// time comes from a GL_TIME_ELAPSED query around the same commands, read back FRAME_TIMER_LATENCY frames later.
+// Must only be used from the GL thread, and no other GL_TIME_ELAPSED query may be active across Begin and End
+class FrameTimer
+{
+public:
+    // constructor
+    FrameTimer();
+
+    // deletes the queries, so the GL context must still be current
+    ~FrameTimer();
+
+    FrameTimer(const FrameTimer&) = delete;
+    FrameTimer& operator=(const FrameTimer&) = delete;
+
+    // brackets the work of one frame
+    void Begin();
+    void End();
+
+    // waits for the queries still in flight, call once after the last frame
+    void Finish();
+
+    // one entry per timed frame. GPU times are complete after Finish
+    std::vector<double> const& CpuMs() const;
+    std::vector<double> const& GpuMs() const;
+
+    // min, nearest-rank median and percentiles, max and mean of values
+    static FrameTimeStats Summarize(std::vector<double> values);
+
+    // writes the frame count, timestep, both summaries and the per-frame times as JSON. name and options describe
+    // the run (path and command line) so results of different configurations are not compared by accident
+    bool WriteJson(std::string const& path, std::string const& name, std::string const& options, float timestep) const;
+
+private:
+    unsigned int queries[FRAME_TIMER_LATENCY];
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    std::chrono::steady_clock::time_point frameStart;
+    size_t frames;
+
+    // reads the GPU time of frame into gpuMs, waiting for it if needed
+    void readGpuTime(size_t frame);
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "frustumculler.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE2
+#endif
+
+namespace
+{
+    // boxes per SIMD register, the SoA arrays are padded to a multiple of it
+#if defined(FRUSTUM_CULLER_AVX)
+    const size_t LANES = 8;
+#elif defined(FRUSTUM_CULLER_SSE2)
+    const size_t LANES = 4;
+#else
+    const size_t LANES = 1;
+#endif
+}
+
+// constructor
+FrustumCuller::FrustumCuller()
+{
+    Stats = CullingStats{ 0, 0 };
+    count = 0;
+}
+
+// forgets every box and the results of the last Cull
+void FrustumCuller::Clear()
+{
+    visible.clear();
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+    count = 0;
+}
+
+// appends a world space box and returns its index
+size_t FrustumCuller::Add(BoundingBox const& box)
+{
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extent = 0.5f * (box.max - box.min);
+
+    // the padding lanes are overwritten first, a new register's worth of lanes is appended when they run out
+    if (count == centerX.size())
+    {
+        size_t padded = count + LANES;
+        centerX.resize(padded, 0.0f);
+        centerY.resize(padded, 0.0f);
+        centerZ.resize(padded, 0.0f);
+        extentX.resize(padded, 0.0f);
+        extentY.resize(padded, 0.0f);
+        extentZ.resize(padded, 0.0f);
+    }
+    centerX[count] = center.x;
+    centerY[count] = center.y;
+    centerZ[count] = center.z;
+    extentX[count] = extent.x;
+    extentY[count] = extent.y;
+    extentZ[count] = extent.z;
+    return count++;
+}
+
+// tests every box added since Clear against frustum. A box is outside a plane if its center is further behind
+// it than the box reaches along the plane normal: dot(n, c) + w + dot(|n|, e) < 0. Every path sums the terms in
+// the order Frustum::Intersects does, so all of them give it the same answer for every box
+void FrustumCuller::Cull(Frustum const& frustum)
+{
+    size_t padded = centerX.size();
+    visible.assign(padded, 0);
+
+#if defined(FRUSTUM_CULLER_AVX)
+    __m256 zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < padded; i += LANES)
+    {
+        __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (glm::vec4 const& plane : frustum.planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+            __m256 radius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex), _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), ey));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (size_t lane = 0; lane < LANES; lane++)
+            visible[i + lane] = (mask >> lane) & 1;
+    }
+#elif defined(FRUSTUM_CULLER_SSE2)
+    __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < padded; i += LANES)
+    {
+        __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (glm::vec4 const& plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+            distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+            __m128 radius = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (size_t lane = 0; lane < LANES; lane++)
+            visible[i + lane] = (mask >> lane) & 1;
+    }
+#else
+    // straight from the stored center and extent, Box(i) would round them once more
+    for (size_t i = 0; i < padded; i++)
+    {
+        glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+        glm::vec3 extent(extentX[i], extentY[i], extentZ[i]);
+        visible[i] = 1;
+        for (glm::vec4 const& plane : frustum.planes)
+        {
+            glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f)
+                visible[i] = 0;
+        }
+    }
+#endif
+
+    Stats.visible = 0;
+    for (size_t i = 0; i < count; i++)
+        Stats.visible += visible[i];
+    Stats.culled = static_cast<unsigned int>(count) - Stats.visible;
+}
+
+// true if box index intersected the frustum in the last Cull
+bool FrustumCuller::Visible(size_t index) const
+{
+    return index < visible.size() && visible[index] != 0;
+}
+
+// marks box index as not visible
+void FrustumCuller::Hide(size_t index)
+{
+    if (index < visible.size())
+        visible[index] = 0;
+}
+
+// box index as added
+BoundingBox FrustumCuller::Box(size_t index) const
+{
+    glm::vec3 center(centerX[index], centerY[index], centerZ[index]);
+    glm::vec3 extent(extentX[index], extentY[index], extentZ[index]);
+    BoundingBox box;
+    box.min = center - extent;
+    box.max = center + extent;
+    return box;
+}
+
+// number of boxes added since Clear
+size_t FrustumCuller::Size() const
+{
+    return count;
+}
+
+// the instruction set Cull was compiled with
+const char* FrustumCuller::InstructionSet()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+    return "AVX";
+#elif defined(FRUSTUM_CULLER_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
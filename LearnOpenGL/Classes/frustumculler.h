@@ -0,0 +1,64 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include "bounds.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// results of the last FrustumCuller::Cull
+struct CullingStats {
+    unsigned int visible;
+    unsigned int culled;
+};
+
+// Tests a frame's world space boxes against a frustum in one pass. Boxes are stored as structure of arrays
+// (center and half extent per axis), so the plane tests run on 8 boxes at a time with AVX, 4 with SSE2 and one
+// at a time otherwise; the instruction set is picked at compile time. Needs no OpenGL context.
+//
+//   size_t first = model.AddBounds(culler, transform);  // or culler.Add(box) per object
+//   culler.Cull(camera.GetFrustum(projection));
+//   if (culler.Visible(first + i)) ...
+class FrustumCuller
+{
+public:
+    // counts of the last Cull
+    CullingStats Stats;
+
+    // constructor
+    FrustumCuller();
+
+    // forgets every box and the results of the last Cull, call at the start of a frame
+    void Clear();
+
+    // appends a world space box and returns its index
+    size_t Add(BoundingBox const& box);
+
+    // tests every box added since Clear against frustum
+    void Cull(Frustum const& frustum);
+
+    // true if box index intersected the frustum in the last Cull, false for every box until Cull ran after Clear
+    bool Visible(size_t index) const;
+
+    // marks box index as not visible, e.g. when a later stage found it occluded. Stats stay frustum only
+    void Hide(size_t index);
+
+    // box index as added
+    BoundingBox Box(size_t index) const;
+
+    // number of boxes added since Clear
+    size_t Size() const;
+
+    // "AVX", "SSE2" or "scalar", whichever Cull was compiled with
+    static const char* InstructionSet();
+
+private:
+    // box centers and half extents, padded to a whole number of SIMD registers
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<uint8_t> visible;
+    size_t count;
+};
+
+#endif
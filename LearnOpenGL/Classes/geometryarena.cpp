@@ -0,0 +1,330 @@
+#include "geometryarena.h"
+#include "vertexcompression.h"
+
+#include <algorithm>
+
+// constructor
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+    this->capacity = 0;
+    used = 0;
+    Grow(capacity);
+}
+
+// finds a free range of size units starting at a multiple of alignment
+bool RangeAllocator::Allocate(size_t size, size_t alignment, GeometryRange& range)
+{
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+        size_t start = (it->first + alignment - 1) / alignment * alignment;
+        size_t end = it->first + it->second;
+        if (start + size > end)
+            continue;
+
+        // split the free range into the padding before and the rest after the allocation
+        size_t freeStart = it->first;
+        freeRanges.erase(it);
+        if (start > freeStart)
+            freeRanges[freeStart] = start - freeStart;
+        if (end > start + size)
+            freeRanges[start + size] = end - (start + size);
+
+        range.offset = start;
+        range.size = size;
+        used += size;
+        return true;
+    }
+    return false;
+}
+
+// returns a range handed out by Allocate
+void RangeAllocator::Free(GeometryRange range)
+{
+    if (range.size == 0)
+        return;
+    used -= range.size;
+
+    // merge with the free neighbours
+    auto next = freeRanges.lower_bound(range.offset);
+    if (next != freeRanges.end() && next->first == range.offset + range.size)
+    {
+        range.size += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == range.offset)
+        {
+            previous->second += range.size;
+            return;
+        }
+    }
+    freeRanges[range.offset] = range.size;
+}
+
+// appends the units [Capacity(), capacity) to the free space
+void RangeAllocator::Grow(size_t capacity)
+{
+    if (capacity <= this->capacity)
+        return;
+    GeometryRange added;
+    added.offset = this->capacity;
+    added.size = capacity - this->capacity;
+    this->capacity = capacity;
+    used += added.size; // Free subtracts it again
+    Free(added);
+}
+
+size_t RangeAllocator::Capacity() const
+{
+    return capacity;
+}
+
+size_t RangeAllocator::Used() const
+{
+    return used;
+}
+
+namespace
+{
+    // initial arena sizes, doubled whenever an allocation does not fit
+    const size_t INITIAL_VERTEX_CAPACITY = 64 * 1024;       // vertices per format
+    const size_t INITIAL_INDEX_CAPACITY = 1024 * 1024;      // bytes
+    const size_t INDEX_ALIGNMENT = sizeof(unsigned int);    // fits 16 and 32-bit index ranges
+
+    const unsigned int FORMAT_COUNT = 2;
+
+    // vertex buffer, VAOs and allocator of one VertexFormat
+    struct VertexPool
+    {
+        unsigned int VAO = 0;
+        unsigned int instancedVAO = 0;
+        unsigned int VBO = 0;
+        RangeAllocator allocator;
+    };
+
+    VertexPool vertexPools[FORMAT_COUNT];
+    unsigned int indexBuffer = 0;
+    RangeAllocator indexAllocator;
+    unsigned int allocations = 0;
+    unsigned int bufferGrowths = 0;
+
+    size_t vertexStride(VertexFormat format)
+    {
+        return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    // creates a buffer of the given size, copying the first copyBytes of the old buffer into it
+    unsigned int reallocateBuffer(unsigned int oldBuffer, size_t copyBytes, size_t bytes)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        // the copy targets leave the element buffer binding of the current VAO alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+        if (oldBuffer != 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, copyBytes);
+            glDeleteBuffers(1, &oldBuffer);
+            bufferGrowths++;
+        }
+        return buffer;
+    }
+
+    // (re)attaches the shared buffers to the VAOs of a format
+    void bindPoolBuffers(VertexFormat format)
+    {
+        VertexPool& pool = vertexPools[format];
+        for (unsigned int vao : { pool.VAO, pool.instancedVAO })
+        {
+            glBindVertexArray(vao);
+            glBindVertexBuffer(0, pool.VBO, 0, static_cast<GLsizei>(vertexStride(format)));
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        }
+        glBindVertexArray(0);
+    }
+
+    void ensureIndexBuffer()
+    {
+        if (indexBuffer != 0)
+            return;
+        indexAllocator.Grow(INITIAL_INDEX_CAPACITY);
+        indexBuffer = reallocateBuffer(0, 0, INITIAL_INDEX_CAPACITY);
+    }
+
+    // VAO with the vertex layout of a format. The attribute layout is set once with separate buffer bindings,
+    // so growing the buffers only has to rebind them
+    unsigned int createVertexArray(VertexFormat format, bool instanced)
+    {
+        unsigned int vao;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        if (format == VERTEX_FORMAT_PACKED)
+        {
+            // vertex Positions, unorm16 inside the bounding box
+            glVertexAttribFormat(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, Position));
+            // vertex normals, octahedral snorm16
+            glVertexAttribFormat(1, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, Normal));
+            // vertex texture coords, half floats
+            glVertexAttribFormat(2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, TexCoords));
+        }
+        else
+        {
+            // vertex Positions
+            glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+            // vertex normals
+            glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+            // vertex texture coords
+            glVertexAttribFormat(2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
+        }
+        for (unsigned int attribute = 0; attribute < 3; attribute++)
+        {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribBinding(attribute, 0);
+        }
+
+        if (instanced)
+        {
+            // model matrix columns
+            for (unsigned int column = 0; column < 4; column++)
+            {
+                glVertexAttribFormat(3 + column, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, Model) + column * sizeof(glm::vec4));
+                glVertexAttribBinding(3 + column, INSTANCE_BUFFER_BINDING);
+                glEnableVertexAttribArray(3 + column);
+            }
+            // normal matrix columns
+            for (unsigned int column = 0; column < 3; column++)
+            {
+                glVertexAttribFormat(7 + column, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, NormalMatrix) + column * sizeof(glm::vec3));
+                glVertexAttribBinding(7 + column, INSTANCE_BUFFER_BINDING);
+                glEnableVertexAttribArray(7 + column);
+            }
+            glVertexBindingDivisor(INSTANCE_BUFFER_BINDING, 1);
+        }
+        glBindVertexArray(0);
+        return vao;
+    }
+
+    // creates the buffer and VAOs of a format on first use
+    VertexPool& vertexPool(VertexFormat format)
+    {
+        VertexPool& pool = vertexPools[format];
+        if (pool.VAO != 0)
+            return pool;
+
+        ensureIndexBuffer();
+        pool.allocator.Grow(INITIAL_VERTEX_CAPACITY);
+        pool.VBO = reallocateBuffer(0, 0, INITIAL_VERTEX_CAPACITY * vertexStride(format));
+        pool.VAO = createVertexArray(format, false);
+        pool.instancedVAO = createVertexArray(format, true);
+
+        bindPoolBuffers(format);
+        return pool;
+    }
+
+    // allocates from allocator, doubling the buffer until the range fits. Returns true if the buffer was replaced
+    bool allocateGrowing(RangeAllocator& allocator, unsigned int& buffer, size_t unitBytes, size_t size, size_t alignment, GeometryRange& range)
+    {
+        bool grown = false;
+        while (!allocator.Allocate(size, alignment, range))
+        {
+            size_t capacity = allocator.Capacity();
+            size_t newCapacity = std::max(capacity * 2, capacity + size + alignment);
+            buffer = reallocateBuffer(buffer, capacity * unitBytes, newCapacity * unitBytes);
+            allocator.Grow(newCapacity);
+            grown = true;
+        }
+        return grown;
+    }
+}
+
+// copies count vertices of the given format into the arena and returns the range they occupy
+GeometryRange GeometryArena::AllocateVertices(VertexFormat format, const void* data, size_t count)
+{
+    VertexPool& pool = vertexPool(format);
+    size_t stride = vertexStride(format);
+
+    GeometryRange range;
+    if (allocateGrowing(pool.allocator, pool.VBO, stride, count, 1, range))
+        bindPoolBuffers(format);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.offset * stride, count * stride, data);
+    allocations++;
+    return range;
+}
+
+// copies bytes of index data into the arena and returns the byte range they occupy
+GeometryRange GeometryArena::AllocateIndices(const void* data, size_t bytes)
+{
+    ensureIndexBuffer();
+
+    GeometryRange range;
+    if (allocateGrowing(indexAllocator, indexBuffer, 1, bytes, INDEX_ALIGNMENT, range))
+    {
+        for (unsigned int format = 0; format < FORMAT_COUNT; format++)
+            if (vertexPools[format].VAO != 0)
+                bindPoolBuffers(static_cast<VertexFormat>(format));
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.offset, bytes, data);
+    allocations++;
+    return range;
+}
+
+// returns ranges to the arena
+void GeometryArena::FreeVertices(VertexFormat format, GeometryRange range)
+{
+    vertexPools[format].allocator.Free(range);
+    allocations--;
+}
+
+void GeometryArena::FreeIndices(GeometryRange range)
+{
+    indexAllocator.Free(range);
+    allocations--;
+}
+
+// the VAO every mesh of a format draws with
+unsigned int GeometryArena::VertexArray(VertexFormat format)
+{
+    return vertexPool(format).VAO;
+}
+
+// the same VAO plus InstanceData attributes 3-9 with divisor 1
+unsigned int GeometryArena::InstancedVertexArray(VertexFormat format)
+{
+    return vertexPool(format).instancedVAO;
+}
+
+// the shared buffers
+unsigned int GeometryArena::VertexBuffer(VertexFormat format)
+{
+    return vertexPool(format).VBO;
+}
+
+unsigned int GeometryArena::IndexBuffer()
+{
+    ensureIndexBuffer();
+    return indexBuffer;
+}
+
+// current counters
+GeometryArenaStats GeometryArena::Stats()
+{
+    GeometryArenaStats stats = {};
+    for (unsigned int format = 0; format < FORMAT_COUNT; format++)
+    {
+        size_t stride = vertexStride(static_cast<VertexFormat>(format));
+        stats.vertexBytesUsed += vertexPools[format].allocator.Used() * stride;
+        stats.vertexBytesCapacity += vertexPools[format].allocator.Capacity() * stride;
+    }
+    stats.indexBytesUsed = indexAllocator.Used();
+    stats.indexBytesCapacity = indexAllocator.Capacity();
+    stats.allocations = allocations;
+    stats.bufferGrowths = bufferGrowths;
+    return stats;
+}
@@ -0,0 +1,85 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+
+#include <cstddef>
+#include <map>
+
+// a sub-range of an arena buffer. For vertex buffers offset and size count vertices, for the index buffer bytes
+struct GeometryRange {
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+// first-fit allocator over [0, capacity). Free ranges are kept sorted by offset and merged with their
+// neighbours on release, so freeing a whole model leaves no fragments behind
+class RangeAllocator
+{
+public:
+    // constructor
+    RangeAllocator(size_t capacity = 0);
+
+    // finds a free range of size units starting at a multiple of alignment. Returns false when none fits
+    bool Allocate(size_t size, size_t alignment, GeometryRange& range);
+
+    // returns a range handed out by Allocate
+    void Free(GeometryRange range);
+
+    // appends the units [Capacity(), capacity) to the free space
+    void Grow(size_t capacity);
+
+    size_t Capacity() const;
+    size_t Used() const;
+
+private:
+    std::map<size_t, size_t> freeRanges; // offset -> size
+    size_t capacity;
+    size_t used;
+};
+
+// arena counters, e.g. for the stats window
+struct GeometryArenaStats {
+    size_t vertexBytesUsed;
+    size_t vertexBytesCapacity;
+    size_t indexBytesUsed;
+    size_t indexBytesCapacity;
+    unsigned int allocations; // live vertex and index ranges
+    unsigned int bufferGrowths;
+};
+
+// Process-wide geometry storage shared by every Mesh: one vertex buffer and one VAO per VertexFormat plus a
+// single index buffer that every VAO references. Meshes only keep their base vertex and index byte offset, so
+// all meshes of a format draw with the same VAO bound. Buffers start small and are reallocated to twice the
+// size when full; the VAOs are rebound then, ranges keep their offsets. Must only be used from the GL thread.
+class GeometryArena
+{
+public:
+    // copies count vertices of the given format into the arena and returns the range they occupy
+    static GeometryRange AllocateVertices(VertexFormat format, const void* data, size_t count);
+
+    // copies bytes of index data (16 or 32-bit indices) into the arena and returns the byte range they occupy
+    static GeometryRange AllocateIndices(const void* data, size_t bytes);
+
+    // returns ranges to the arena. Only bookkeeping, the buffers keep their size
+    static void FreeVertices(VertexFormat format, GeometryRange range);
+    static void FreeIndices(GeometryRange range);
+
+    // the VAO every mesh of a format draws with, its element buffer is the shared index buffer
+    static unsigned int VertexArray(VertexFormat format);
+
+    // the same VAO plus InstanceData attributes 3-9 with divisor 1, read from INSTANCE_BUFFER_BINDING. The
+    // instance buffer is bound by the instanced draw itself
+    static unsigned int InstancedVertexArray(VertexFormat format);
+
+    // the shared buffers, e.g. for indirect draws
+    static unsigned int VertexBuffer(VertexFormat format);
+    static unsigned int IndexBuffer();
+
+    // current counters
+    static GeometryArenaStats Stats();
+};
+
+#endif
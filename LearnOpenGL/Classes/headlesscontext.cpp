@@ -0,0 +1,115 @@
+#include "headlesscontext.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// older eglext.h versions predate the surfaceless platform
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+// constructor, no context yet
+HeadlessContext::HeadlessContext()
+{
+    display = nullptr;
+    context = nullptr;
+    version = 0;
+}
+
+// destroys the context and releases the display
+HeadlessContext::~HeadlessContext()
+{
+#if defined(__linux__)
+    if (context)
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+    }
+    if (display)
+        eglTerminate(display);
+#endif
+}
+
+// creates a 4.6 or 4.5 core profile context and makes it current
+bool HeadlessContext::Create()
+{
+#if defined(__linux__)
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!getPlatformDisplay)
+    {
+        std::cout << "ERROR::HEADLESS::NO_EGL_PLATFORM_DISPLAY" << std::endl;
+        return false;
+    }
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cout << "ERROR::HEADLESS::SURFACELESS_DISPLAY_UNAVAILABLE" << std::endl;
+        display = nullptr;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "ERROR::HEADLESS::NO_OPENGL_API" << std::endl;
+        return false;
+    }
+
+    // no surface is ever created, any config that renders OpenGL will do. Without one, EGL_KHR_no_config_context
+    EGLint configAttributes[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+        config = nullptr;
+
+    const int versions[] = { 46, 45 };
+    for (int candidate : versions)
+    {
+        EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, candidate / 10,
+            EGL_CONTEXT_MINOR_VERSION, candidate % 10,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context != EGL_NO_CONTEXT)
+        {
+            version = candidate;
+            break;
+        }
+    }
+    if (!context)
+    {
+        std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cout << "ERROR::HEADLESS::EGL_NOT_AVAILABLE_ON_THIS_PLATFORM" << std::endl;
+    return false;
+#endif
+}
+
+// major * 10 + minor of the created context
+int HeadlessContext::Version() const
+{
+    return version;
+}
+
+// entry point loader for gladLoadGLLoader
+void* HeadlessContext::GetProcAddress(const char* name)
+{
+#if defined(__linux__)
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+#else
+    return nullptr;
+#endif
+}
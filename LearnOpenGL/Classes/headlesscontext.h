@@ -0,0 +1,40 @@
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+// An OpenGL core profile context without a window or any surface, for build and CI machines without a display
+// or GPU. It is created through EGL on Mesa's surfaceless platform (EGL_MESA_platform_surfaceless), which works
+// with the llvmpipe software rasterizer; everything is rendered into framebuffer objects (see OffscreenTarget).
+// EGL is only used on Linux, elsewhere Create fails and the caller falls back to a window.
+//
+//   HeadlessContext context;
+//   if (context.Create())
+//       gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress);
+class HeadlessContext
+{
+public:
+    // constructor, no context yet
+    HeadlessContext();
+
+    // destroys the context and releases the display
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // creates a 4.6 core profile context, or a 4.5 one if the driver has no 4.6 (llvmpipe), and makes it
+    // current on the calling thread. Prints the error and returns false if neither works
+    bool Create();
+
+    // major * 10 + minor of the created context, e.g. 45
+    int Version() const;
+
+    // entry point loader for gladLoadGLLoader and LoadBindlessTextures
+    static void* GetProcAddress(const char* name);
+
+private:
+    void* display;
+    void* context;
+    int version;
+};
+
+#endif
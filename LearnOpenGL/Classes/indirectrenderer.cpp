@@ -0,0 +1,211 @@
+#include "indirectrenderer.h"
+#include "bindlesstextures.h"
+#include "profiler.h"
+#include "textureregistry.h"
+
+#include <algorithm>
+
+// constructor
+IndirectRenderer::IndirectRenderer(bool bindless)
+{
+    DrawCalls = 0;
+    Commands = 0;
+    commandBufferSize = 0;
+    drawDataBufferSize = 0;
+    materialDataBufferSize = 0;
+    uniformProgram = 0;
+    missingTexture = 0;
+    this->bindless = bindless && BindlessTexturesSupported();
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &drawDataBuffer);
+    glGenBuffers(1, &materialDataBuffer);
+
+    if (this->bindless)
+    {
+        const unsigned char black[4] = { 0, 0, 0, 255 };
+        glGenTextures(1, &missingTexture);
+        glBindTexture(GL_TEXTURE_2D, missingTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, black);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+// deletes the command, draw data and material buffers and the placeholder texture
+IndirectRenderer::~IndirectRenderer()
+{
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &drawDataBuffer);
+    glDeleteBuffers(1, &materialDataBuffer);
+    if (missingTexture != 0)
+    {
+        ReleaseTextureHandle(missingTexture);
+        glDeleteTextures(1, &missingTexture);
+    }
+}
+
+// queues a mesh drawn with the given model matrix and level of detail
+void IndirectRenderer::Add(Mesh& mesh, glm::mat4 const& model, unsigned int lod)
+{
+    queue.push_back(QueuedDraw{ &mesh, model, lod });
+}
+
+// draws everything queued since the last Flush and clears the queue
+void IndirectRenderer::Flush(Shader& shader)
+{
+    PROFILE_GPU_SCOPE("IndirectRenderer::Flush");
+    DrawCalls = 0;
+    Commands = static_cast<unsigned int>(queue.size());
+    if (queue.empty())
+        return;
+
+    // order the queue so every batch is one contiguous run of commands
+    std::stable_sort(queue.begin(), queue.end(), [this](QueuedDraw const& a, QueuedDraw const& b)
+    {
+        return batchLess(*a.mesh, *b.mesh);
+    });
+
+    // one command and one draw data entry per queued mesh
+    commands.clear();
+    drawData.clear();
+    materialData.clear();
+    for (QueuedDraw const& draw : queue)
+    {
+        Mesh const& mesh = *draw.mesh;
+        size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        DrawElementsIndirectCommand command;
+        command.count = static_cast<uint32_t>(mesh.LodIndexCount(draw.lod));
+        command.instanceCount = 1;
+        command.firstIndex = static_cast<uint32_t>(mesh.LodIndexOffset(draw.lod) / indexSize);
+        command.baseVertex = mesh.baseVertex;
+        command.baseInstance = 0;
+        commands.push_back(command);
+
+        IndirectDrawData data;
+        data.model = draw.model;
+        glm::mat3 normalMatrix = Shader::NormalMatrix(draw.model);
+        for (int column = 0; column < 3; column++)
+            data.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+        data.positionOffset = glm::vec4(mesh.positionOffset, mesh.format == VERTEX_FORMAT_PACKED ? 1.0f : 0.0f);
+        data.positionScale = glm::vec4(mesh.positionScale, 0.0f);
+        drawData.push_back(data);
+
+        if (bindless)
+            materialData.push_back(materialOf(mesh));
+    }
+    upload(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commandBufferSize, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+    upload(GL_SHADER_STORAGE_BUFFER, drawDataBuffer, drawDataBufferSize, drawData.data(), drawData.size() * sizeof(IndirectDrawData));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+    if (bindless)
+    {
+        upload(GL_SHADER_STORAGE_BUFFER, materialDataBuffer, materialDataBufferSize, materialData.data(), materialData.size() * sizeof(IndirectMaterialData));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_DATA_BINDING, materialDataBuffer);
+    }
+
+    if (uniformProgram != shader.ID)
+    {
+        firstDrawUniform = shader.getUniform("firstDraw");
+        uniformProgram = shader.ID;
+    }
+
+    // one multi draw per batch, the batch's first mesh sets the shared VAO and, without bindless, the textures
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    size_t first = 0;
+    while (first < queue.size())
+    {
+        size_t last = first + 1;
+        while (last < queue.size() && sameBatch(*queue[first].mesh, *queue[last].mesh))
+            last++;
+
+        Mesh& mesh = *queue[first].mesh;
+        if (!bindless)
+            mesh.BindTextures(shader);
+        shader.setInt(firstDrawUniform, static_cast<int>(first));
+        glBindVertexArray(mesh.VAO);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, (void*)(first * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(last - first), 0);
+        DrawCalls++;
+
+        first = last;
+    }
+
+    // set back to default
+    glActiveTexture(GL_TEXTURE0);
+    queue.clear();
+}
+
+// true if textures are accessed through bindless handles
+bool IndirectRenderer::UsesBindless() const
+{
+    return bindless;
+}
+
+// strict weak order that makes every batch a contiguous run
+bool IndirectRenderer::batchLess(Mesh const& a, Mesh const& b) const
+{
+    if (a.format != b.format)
+        return a.format < b.format;
+    if (a.indexType != b.indexType)
+        return a.indexType < b.indexType;
+    if (bindless)
+        return false;
+    return std::lexicographical_compare(a.textures.begin(), a.textures.end(), b.textures.begin(), b.textures.end(),
+        [](Texture const& s, Texture const& t) { return s.id < t.id; });
+}
+
+// true if both draws can share one multi draw
+bool IndirectRenderer::sameBatch(Mesh const& a, Mesh const& b) const
+{
+    if (a.format != b.format || a.indexType != b.indexType)
+        return false;
+    if (bindless)
+        return true;
+    if (a.textures.size() != b.textures.size())
+        return false;
+    for (size_t i = 0; i < a.textures.size(); i++)
+        if (a.textures[i].id != b.textures[i].id)
+            return false;
+    return true;
+}
+
+// bindless handles of the first diffuse and specular texture of a mesh
+IndirectMaterialData IndirectRenderer::materialOf(Mesh const& mesh)
+{
+    unsigned int diffuse = missingTexture;
+    unsigned int specular = missingTexture;
+    for (int i = static_cast<int>(mesh.textures.size()) - 1; i >= 0; i--)
+    {
+        if (mesh.textures[i].type == "texture_diffuse")
+            diffuse = mesh.textures[i].id;
+        else if (mesh.textures[i].type == "texture_specular")
+            specular = mesh.textures[i].id;
+    }
+    // a texture the streamer is still filling keeps the placeholder, its handle would freeze it half uploaded.
+    // The material data is rebuilt every frame, so the real handle is picked up once the upload finished
+    if (!TextureRegistry::IsUploaded(diffuse))
+        diffuse = missingTexture;
+    if (!TextureRegistry::IsUploaded(specular))
+        specular = missingTexture;
+    // no handle at all, e.g. for a texture without storage, samples the placeholder rather than handle 0
+    GLuint64 diffuseHandle = TextureHandle(diffuse);
+    GLuint64 specularHandle = TextureHandle(specular);
+    if (diffuseHandle == 0)
+        diffuseHandle = TextureHandle(missingTexture);
+    if (specularHandle == 0)
+        specularHandle = TextureHandle(missingTexture);
+    return IndirectMaterialData{ diffuseHandle, specularHandle };
+}
+
+// replaces the contents of buffer, growing it if needed
+void IndirectRenderer::upload(GLenum target, unsigned int buffer, size_t& capacity, const void* data, size_t bytes)
+{
+    if (bytes > capacity)
+        capacity = std::max(bytes, capacity * 2);
+
+    // orphan the old storage so the driver does not wait for last frame's draws
+    glBindBuffer(target, buffer);
+    glBufferData(target, capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, bytes, data);
+}
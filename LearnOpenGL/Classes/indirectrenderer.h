@@ -0,0 +1,114 @@
+#ifndef INDIRECTRENDERER_H
+#define INDIRECTRENDERER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "shader.h"
+
+#include <cstdint>
+#include <vector>
+
+// shader storage bindings of the per-draw data read by indirect.vert and the materials read by bindless.frag
+const unsigned int DRAW_DATA_BINDING = 0;
+const unsigned int MATERIAL_DATA_BINDING = 1;
+
+// layout of glMultiDrawElementsIndirect commands
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t  baseVertex;
+    uint32_t baseInstance;
+};
+
+// std430 per-draw data, indexed with firstDraw + gl_DrawID in indirect.vert
+struct IndirectDrawData {
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3]; // mat3 columns padded to vec4 as std430 lays them out
+    glm::vec4 positionOffset;  // w is 1 for octahedral normals
+    glm::vec4 positionScale;
+};
+
+// std430 per-draw bindless texture handles (uvec2 in bindless.frag), same index as IndirectDrawData
+struct IndirectMaterialData {
+    GLuint64 diffuse;
+    GLuint64 specular;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "indirect command layout");
+static_assert(sizeof(IndirectDrawData) == 144, "std430 DrawData layout");
+static_assert(sizeof(IndirectMaterialData) == 16, "std430 Material layout");
+
+// Collects the meshes of a frame and draws them with one glMultiDrawElementsIndirect per batch instead of one
+// glDrawElements per mesh. Meshes are batched by vertex format, index type and textures, so in a batch only
+// the model and normal matrices and the vertex decode parameters differ; those come from a shader storage
+// buffer that the vertex shader indexes with gl_DrawID. In bindless mode (ARB_bindless_texture) the texture handles come from
+// a second storage buffer as well, so batches only split on vertex format and index type and no texture is
+// bound at all. Without the extension the renderer falls back to binding textures per batch.
+class IndirectRenderer
+{
+public:
+    // draw calls and commands of the last Flush
+    unsigned int DrawCalls;
+    unsigned int Commands;
+
+    // constructor. bindless is ignored when the extension is missing, see UsesBindless
+    IndirectRenderer(bool bindless = false);
+
+    // deletes the command, draw data and material buffers and the placeholder texture, so the GL context must
+    // still be current
+    ~IndirectRenderer();
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // queues a mesh drawn with the given model matrix and level of detail. The mesh has to stay alive until Flush
+    void Add(Mesh& mesh, glm::mat4 const& model, unsigned int lod = 0);
+
+    // draws everything queued since the last Flush with shader (indirect.vert with shader.frag, or with
+    // bindless.frag in bindless mode) and clears the queue
+    void Flush(Shader& shader);
+
+    // true if textures are accessed through bindless handles
+    bool UsesBindless() const;
+
+private:
+    struct QueuedDraw {
+        Mesh* mesh;
+        glm::mat4 model;
+        unsigned int lod;
+    };
+
+    std::vector<QueuedDraw> queue;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawData> drawData;
+    std::vector<IndirectMaterialData> materialData;
+
+    unsigned int commandBuffer, drawDataBuffer, materialDataBuffer;
+    size_t commandBufferSize, drawDataBufferSize, materialDataBufferSize;
+
+    // bindless mode and the black texture standing in for missing diffuse / specular maps
+    bool bindless;
+    unsigned int missingTexture;
+
+    // firstDraw uniform of the program in uniformProgram
+    UniformHandle firstDrawUniform;
+    unsigned int uniformProgram;
+
+    // strict weak order that makes every batch a contiguous run
+    bool batchLess(Mesh const& a, Mesh const& b) const;
+
+    // true if both draws can share one multi draw
+    bool sameBatch(Mesh const& a, Mesh const& b) const;
+
+    // bindless handles of the first diffuse and specular texture of a mesh, the placeholder's while one is still uploading
+    IndirectMaterialData materialOf(Mesh const& mesh);
+
+    // replaces the contents of buffer, growing it if needed
+    static void upload(GLenum target, unsigned int buffer, size_t& capacity, const void* data, size_t bytes);
+};
+
+#endif
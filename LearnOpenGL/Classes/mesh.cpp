@@ -1,26 +1,181 @@
 #include "mesh.h"
+#include "geometryarena.h"
+#include "meshletculler.h"
+#include "meshprocessing.h"
+#include "vertexcompression.h"
+
+#include <algorithm>
+#include <cstdint>
 
 // constructor
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, VertexFormat format,
+    std::vector<MeshLod> lods, std::vector<Meshlet> meshlets)
 {
     this->vertices = vertices;
     this->indices = indices;
     this->textures = textures;
+    this->format = format;
+    this->lods = lods;
+    this->meshlets = meshlets;
+    uniformProgram = 0;
+
+    const glm::vec3* positions = this->vertices.empty() ? nullptr : &this->vertices[0].Position;
+    boundingBox = ComputeBoundingBox(positions, this->vertices.size(), sizeof(Vertex));
+    boundingSphere = ComputeBoundingSphere(positions, this->vertices.size(), sizeof(Vertex));
 
     // now that we have all the required data, set the vertex buffers and its attribute pointers.
     setupMesh();
 }
 
 // render mesh
-void Mesh::Draw(Shader& shader)
+void Mesh::Draw(Shader& shader, unsigned int lod)
 {
     // bind appropriate textures
+    BindTextures(shader);
+
+    // draw mesh. The VAO stays bound, the next mesh of the same format very likely uses it too
+    glBindVertexArray(VAO);
+    DrawElements(shader, lod);
+
+    // set back to defualt
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// render the meshlets the last culler.Cull of this mesh left visible
+void Mesh::DrawMeshlets(Shader& shader, MeshletCuller const& culler)
+{
+    if (culler.Ranges() == 0)
+        return;
+
+    BindTextures(shader);
+    glBindVertexArray(VAO);
+    setVertexUniforms(shader, false);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, culler.Counts(), indexType, culler.Offsets(), culler.Ranges(), culler.BaseVertices());
+
+    // set back to defualt
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// sets the vertex decode uniforms and issues the draw call
+void Mesh::DrawElements(Shader& shader, unsigned int lod)
+{
+    setVertexUniforms(shader, false);
+    glDrawElementsBaseVertex(GL_TRIANGLES, LodIndexCount(lod), indexType, (void*)LodIndexOffset(lod), baseVertex);
+}
+
+// render count instances of the mesh, reading InstanceData from instanceBuffer
+void Mesh::DrawInstanced(Shader& shader, unsigned int instanceBuffer, GLsizei count)
+{
+    BindTextures(shader);
+    setVertexUniforms(shader, true);
+
+    glBindVertexArray(instancedVAO);
+    glBindVertexBuffer(INSTANCE_BUFFER_BINDING, instanceBuffer, 0, sizeof(InstanceData));
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), indexType, (void*)indexOffset, count, baseVertex);
+
+    // set back to defualt
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// sets how shader.vert decodes this mesh's vertices and whether it reads per-instance matrices
+void Mesh::setVertexUniforms(Shader& shader, bool instanced)
+{
+    if (uniformProgram != shader.ID)
+        resolveUniforms(shader);
+
+    shader.setVec3(positionOffsetUniform, positionOffset);
+    shader.setVec3(positionScaleUniform, positionScale);
+    shader.setBool(octahedralNormalsUniform, format == VERTEX_FORMAT_PACKED);
+    shader.setBool(instancedUniform, instanced);
+}
+
+// binds the textures to consecutive units and points the material samplers of shader at them
+void Mesh::BindTextures(Shader& shader)
+{
+    // uniform names only have to be resolved again when a different shader draws this mesh
+    if (uniformProgram != shader.ID)
+        resolveUniforms(shader);
+
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+        // now set the sampler to the correct texture unit
+        shader.setInt(samplerUniforms[i], i);
+        // and finally bind the texture
+        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    }
+}
+
+// returns the vertex and index ranges to the GeometryArena
+void Mesh::Release()
+{
+    GeometryRange vertexRange;
+    vertexRange.offset = static_cast<size_t>(baseVertex);
+    vertexRange.size = vertices.size();
+    GeometryArena::FreeVertices(format, vertexRange);
+
+    GeometryRange indexRange;
+    indexRange.offset = indexOffset;
+    indexRange.size = indexBufferSize;
+    GeometryArena::FreeIndices(indexRange);
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    for (MeshLod const& lod : lods)
+    {
+        indexRange.offset = lod.indexOffset;
+        indexRange.size = lod.indices.size() * indexSize;
+        GeometryArena::FreeIndices(indexRange);
+    }
+}
+
+// number of levels of detail, the full mesh included
+unsigned int Mesh::LodCount() const
+{
+    return static_cast<unsigned int>(lods.size()) + 1;
+}
+
+// index count of a level of detail, levels past the coarsest one draw the coarsest
+GLsizei Mesh::LodIndexCount(unsigned int lod) const
+{
+    lod = std::min(lod, LodCount() - 1);
+    return static_cast<GLsizei>(lod == 0 ? indices.size() : lods[lod - 1].indices.size());
+}
+
+// byte offset of a level of detail in the GeometryArena index buffer
+size_t Mesh::LodIndexOffset(unsigned int lod) const
+{
+    lod = std::min(lod, LodCount() - 1);
+    return lod == 0 ? indexOffset : lods[lod - 1].indexOffset;
+}
+
+// simplification error of a level of detail in model units
+float Mesh::LodError(unsigned int lod) const
+{
+    lod = std::min(lod, LodCount() - 1);
+    return lod == 0 ? 0.0f : lods[lod - 1].error;
+}
+
+// the coarsest level whose projected error stays within maxPixelError pixels
+unsigned int Mesh::SelectLod(float distance, float pixelsPerUnit, float maxPixelError) const
+{
+    // inside the bounding sphere nothing but the full mesh is safe
+    if (distance <= 0.0f)
+        return 0;
+    unsigned int lod = 0;
+    while (lod + 1 < LodCount() && lods[lod].error * pixelsPerUnit / distance <= maxPixelError)
+        lod++;
+    return lod;
+}
+
+// resolves the material.texture_diffuseN / texture_specularN samplers and the decode uniforms of shader
+void Mesh::resolveUniforms(Shader& shader)
+{
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
 
+    samplerUniforms.clear();
     for (unsigned int i = 0; i < textures.size(); i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
         // retrieve texture number (the N in diffuse_textureN)
         std::string number;
         std::string name = textures[i].type;
@@ -29,47 +184,62 @@ void Mesh::Draw(Shader& shader)
         else if (name == "texture_specular")
             number = std::to_string(specularNr++); // transfer unsigned int to string
 
-        // now set the sampler to the correct texture unit
-        shader.setFloat(("material." + name + number).c_str(), i);
-        // and finally bind the texture
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        samplerUniforms.push_back(shader.getUniform("material." + name + number));
     }
-
-    // draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-
-    // set back to defualt
-    glBindVertexArray(0);
-    glActiveTexture(GL_TEXTURE0);
+    positionOffsetUniform = shader.getUniform("positionOffset");
+    positionScaleUniform = shader.getUniform("positionScale");
+    octahedralNormalsUniform = shader.getUniform("octahedralNormals");
+    instancedUniform = shader.getUniform("instanced");
+    uniformProgram = shader.ID;
 }
 
+// uploads vertices and indices into the GeometryArena
 void Mesh::setupMesh()
 {
-    // create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    // load data into the format's shared vertex buffer
+    GeometryRange vertexRange;
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        PackedVertices packed = PackVertices(vertices);
+        positionOffset = packed.offset;
+        positionScale = packed.scale;
+        vertexBufferSize = packed.vertices.size() * sizeof(PackedVertex);
+        vertexRange = GeometryArena::AllocateVertices(format, packed.vertices.data(), packed.vertices.size());
+    }
+    else
+    {
+        positionOffset = glm::vec3(0.0f);
+        positionScale = glm::vec3(1.0f);
+        vertexBufferSize = vertices.size() * sizeof(Vertex);
+        vertexRange = GeometryArena::AllocateVertices(format, vertices.data(), vertices.size());
+    }
+    baseVertex = static_cast<GLint>(vertexRange.offset);
 
-    glBindVertexArray(VAO);
-    // load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // set the vertex attribute pointers
-    // vertex Positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-
-    // set back to default
-    glBindVertexArray(0);
-}
\ No newline at end of file
+    // half the index memory and bandwidth whenever every index fits in 16 bits. Indices stay relative to the
+    // mesh, the base vertex is added at draw time
+    GeometryRange indexRange;
+    if (vertices.size() <= MAX_16BIT_VERTICES)
+    {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        indexBufferSize = shortIndices.size() * sizeof(uint16_t);
+        indexRange = GeometryArena::AllocateIndices(shortIndices.data(), indexBufferSize);
+        for (MeshLod& lod : lods)
+        {
+            shortIndices.assign(lod.indices.begin(), lod.indices.end());
+            lod.indexOffset = GeometryArena::AllocateIndices(shortIndices.data(), shortIndices.size() * sizeof(uint16_t)).offset;
+        }
+    }
+    else
+    {
+        indexType = GL_UNSIGNED_INT;
+        indexBufferSize = indices.size() * sizeof(unsigned int);
+        indexRange = GeometryArena::AllocateIndices(indices.data(), indexBufferSize);
+        for (MeshLod& lod : lods)
+            lod.indexOffset = GeometryArena::AllocateIndices(lod.indices.data(), lod.indices.size() * sizeof(unsigned int)).offset;
+    }
+    indexOffset = indexRange.offset;
+
+    VAO = GeometryArena::VertexArray(format);
+    instancedVAO = GeometryArena::InstancedVertexArray(format);
+}
@@ -6,8 +6,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "bounds.h"
 #include "shader.h"
 
+#include <cstddef>
+
 #include <string>
 #include <vector>
 
@@ -20,6 +23,46 @@ struct Vertex {
     glm::vec2 TexCoords;
 };
 
+// per-instance vertex attributes of instanced draws, locations 3-6 (model) and 7-9 (normal matrix) in shader.vert
+struct InstanceData {
+    glm::mat4 Model;
+    glm::mat3 NormalMatrix; // Shader::NormalMatrix(Model), computed once per instance on the CPU
+};
+
+// a coarser version of a mesh: its own index buffer over the same vertices (see GenerateLods)
+struct MeshLod {
+    std::vector<unsigned int> indices;
+    float error = 0.0f;     // largest distance of the full mesh from this one, in model units
+    size_t indexOffset = 0; // byte offset in the GeometryArena index buffer, set on upload
+};
+
+// largest meshlet, small enough that a meshlet's vertices and triangles fit a mesh shader workgroup
+const unsigned int MAX_MESHLET_VERTICES = 64;
+const unsigned int MAX_MESHLET_TRIANGLES = 124;
+
+// a cluster of neighbouring triangles: a contiguous range of the mesh's index buffer (see BuildMeshlets) with
+// the bounds to cull it on its own. All fields are model space
+struct Meshlet {
+    unsigned int firstIndex;    // first index of the range in Mesh::indices
+    unsigned int triangleCount;
+    unsigned int vertexCount;   // distinct vertices the triangles use
+    BoundingSphere bounds;
+    glm::vec3 coneApex;         // normal cone: every triangle faces away from an eye for which
+    glm::vec3 coneAxis;         // dot(normalize(coneApex - eye), coneAxis) >= coneCutoff.
+    float coneCutoff;           // Above 1 when the normals spread too far to ever cull
+};
+
+class MeshletCuller;
+
+// vertex buffer binding the instance attributes are read from in GeometryArena::InstancedVertexArray
+const unsigned int INSTANCE_BUFFER_BINDING = 1;
+
+// vertex layout uploaded to the GPU, chosen per mesh at load time
+enum VertexFormat {
+    VERTEX_FORMAT_FULL,  // Vertex as is, 32 bytes
+    VERTEX_FORMAT_PACKED // PackedVertex (vertexcompression.h), 16 bytes
+};
+
 struct Texture {
     unsigned int id;
     std::string type; // e.g. diffuse or specular
@@ -32,19 +75,82 @@ public:
     std::vector<Vertex>       vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture>      textures;
-    unsigned int VAO;
+    unsigned int VAO; // shared by every mesh of the same format, see GeometryArena
+    unsigned int instancedVAO; // same vertices plus the per-instance attributes
+
+    // GPU vertex and index data. Meshes with up to 65536 vertices use GL_UNSIGNED_SHORT indices
+    VertexFormat format;
+    size_t vertexBufferSize;
+    GLenum indexType;
+    size_t indexBufferSize;
+
+    // where the data lives in the GeometryArena: vertices start at baseVertex, indices at indexOffset bytes
+    GLint baseVertex;
+    size_t indexOffset;
+
+    // packed positions are decoded as positionOffset + positionScale * unorm position
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+
+    // model space bounds of the vertices, computed on import
+    BoundingBox boundingBox;
+    BoundingSphere boundingSphere;
+
+    // levels of detail after the full mesh (level 0), each coarser than the one before
+    std::vector<MeshLod> lods;
+
+    // clusters of the full mesh, each a range of indices. Empty unless built on import
+    std::vector<Meshlet> meshlets;
 
     // constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, VertexFormat format = VERTEX_FORMAT_FULL,
+        std::vector<MeshLod> lods = std::vector<MeshLod>(), std::vector<Meshlet> meshlets = std::vector<Meshlet>());
+
+    // render the mesh at the given level of detail
+    void Draw(Shader& shader, unsigned int lod = 0);
+
+    // render the meshlets the last culler.Cull of this mesh left visible, with one multi draw
+    void DrawMeshlets(Shader& shader, MeshletCuller const& culler);
+
+    // binds the textures to consecutive units and points the material samplers of shader at them
+    void BindTextures(Shader& shader);
+
+    // sets the vertex decode uniforms and issues the draw call. VAO and textures have to be bound already
+    void DrawElements(Shader& shader, unsigned int lod = 0);
 
-    // render the mesh
-    void Draw(Shader& shader);
+    // render count instances of the mesh, reading InstanceData from instanceBuffer
+    void DrawInstanced(Shader& shader, unsigned int instanceBuffer, GLsizei count);
+
+    // returns the vertex and index ranges to the GeometryArena
+    void Release();
+
+    // number of levels of detail, the full mesh included
+    unsigned int LodCount() const;
+
+    // index count and byte offset in the GeometryArena index buffer of a level of detail
+    GLsizei LodIndexCount(unsigned int lod) const;
+    size_t LodIndexOffset(unsigned int lod) const;
+
+    // simplification error of a level of detail in model units, 0 for the full mesh
+    float LodError(unsigned int lod) const;
+
+    // the coarsest level whose error, seen from distance, covers at most maxPixelError pixels. pixelsPerUnit is
+    // the size in pixels of one unit at distance 1 (Camera::PixelsPerUnit), distance is in model units
+    unsigned int SelectLod(float distance, float pixelsPerUnit, float maxPixelError) const;
 
 private:
-    // render data 
-    unsigned int VBO, EBO;
+    // uniforms of the program in uniformProgram: one sampler per texture and the vertex decode parameters
+    std::vector<UniformHandle> samplerUniforms;
+    UniformHandle positionOffsetUniform, positionScaleUniform, octahedralNormalsUniform, instancedUniform;
+    unsigned int uniformProgram;
+
+    // resolves the material.texture_diffuseN / texture_specularN samplers and the decode uniforms of shader
+    void resolveUniforms(Shader& shader);
+
+    // sets how shader.vert decodes this mesh's vertices and whether it reads per-instance matrices
+    void setVertexUniforms(Shader& shader, bool instanced);
 
-    // initializes all the buffer objects/arrays
+    // uploads vertices and indices into the GeometryArena
     void setupMesh();
 };
 
@@ -0,0 +1,312 @@
+#include "meshcache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+unsigned int MeshCache::Hits = 0;
+unsigned int MeshCache::Misses = 0;
+
+// every cache file starts with these 8 bytes
+static const char MAGIC[8] = { 'L', 'O', 'G', 'L', 'M', 'E', 'S', 'H' };
+
+namespace
+{
+    // read-only memory mapping of a whole file, unmapped when it goes out of scope
+    class MappedFile
+    {
+    public:
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+
+        MappedFile(std::string const& path)
+        {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+                return;
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping == NULL)
+                return;
+            data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (data)
+                size = static_cast<size_t>(fileSize.QuadPart);
+#else
+            fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+                return;
+            void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+                return;
+            data = static_cast<const unsigned char*>(mapped);
+            size = static_cast<size_t>(st.st_size);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (data)
+                UnmapViewOfFile(data);
+            if (mapping != NULL)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+#else
+            if (data)
+                munmap(const_cast<unsigned char*>(data), size);
+            if (fd >= 0)
+                close(fd);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+    private:
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#else
+        int fd = -1;
+#endif
+    };
+
+    // bounds checked cursor over the mapped cache file
+    struct Reader
+    {
+        const unsigned char* cur;
+        const unsigned char* end;
+
+        bool read(void* dst, size_t bytes)
+        {
+            if (static_cast<size_t>(end - cur) < bytes)
+                return false;
+            std::memcpy(dst, cur, bytes);
+            cur += bytes;
+            return true;
+        }
+
+        template <typename T>
+        bool read(T& value)
+        {
+            return read(&value, sizeof(T));
+        }
+
+        bool readString(std::string& str)
+        {
+            uint32_t length;
+            if (!read(length) || static_cast<size_t>(end - cur) < length)
+                return false;
+            str.assign(reinterpret_cast<const char*>(cur), length);
+            cur += length;
+            return true;
+        }
+
+        template <typename T>
+        bool readArray(std::vector<T>& values)
+        {
+            uint32_t count;
+            if (!read(count) || static_cast<size_t>(end - cur) / sizeof(T) < count)
+                return false;
+            values.resize(count);
+            return read(values.data(), count * sizeof(T));
+        }
+    };
+
+    template <typename T>
+    void write(std::ofstream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(std::ofstream& out, std::string const& str)
+    {
+        write(out, static_cast<uint32_t>(str.size()));
+        out.write(str.data(), str.size());
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& out, std::vector<T> const& values)
+    {
+        write(out, static_cast<uint32_t>(values.size()));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    // modification time of the source file, part of the cache key
+    bool sourceTime(std::string const& path, int64_t& time)
+    {
+        std::error_code ec;
+        auto stamp = std::filesystem::last_write_time(path, ec);
+        if (ec)
+            return false;
+        time = static_cast<int64_t>(stamp.time_since_epoch().count());
+        return true;
+    }
+
+    // modification time of a file the model depends on, -1 while it is missing so creating it is a change too
+    int64_t dependencyTime(std::string const& path)
+    {
+        int64_t time;
+        return sourceTime(path, time) ? time : -1;
+    }
+}
+
+// returns the path of the cache file that belongs to a model file
+std::string MeshCache::CachePath(std::string const& path)
+{
+    return path + ".meshcache";
+}
+
+// memory-maps the cache file of a model and reads back its meshes
+bool MeshCache::Load(std::string const& path, unsigned int flags, unsigned int processing, std::vector<CachedMesh>& meshes)
+{
+    int64_t modified;
+    MappedFile file(CachePath(path));
+    if (!file.data || !sourceTime(path, modified))
+    {
+        Misses++;
+        return false;
+    }
+
+    Reader reader = { file.data, file.data + file.size };
+
+    // header, compare against the cache key
+    char magic[8];
+    uint32_t version, cachedFlags, cachedProcessing, vertexSize;
+    int64_t cachedModified;
+    std::string cachedPath;
+    bool valid = reader.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+        && reader.read(version) && version == MESH_CACHE_VERSION
+        && reader.read(vertexSize) && vertexSize == sizeof(Vertex)
+        && reader.read(cachedFlags) && cachedFlags == flags
+        && reader.read(cachedProcessing) && cachedProcessing == processing
+        && reader.read(cachedModified) && cachedModified == modified
+        && reader.readString(cachedPath) && cachedPath == path;
+
+    // material libraries and textures, each one unchanged since the cache was written
+    uint32_t dependencyCount = 0;
+    valid = valid && reader.read(dependencyCount);
+    for (uint32_t i = 0; valid && i < dependencyCount; i++)
+    {
+        std::string dependency;
+        int64_t cachedTime;
+        valid = reader.readString(dependency) && reader.read(cachedTime) && cachedTime == dependencyTime(dependency);
+    }
+
+    // mesh data
+    uint32_t meshCount = 0;
+    valid = valid && reader.read(meshCount);
+    std::vector<CachedMesh> result(valid ? meshCount : 0);
+    for (uint32_t i = 0; valid && i < meshCount; i++)
+    {
+        CachedMesh& mesh = result[i];
+        uint32_t lodCount = 0;
+        uint32_t textureCount = 0;
+        valid = reader.readArray(mesh.vertices) && reader.readArray(mesh.indices) && reader.read(lodCount);
+        for (uint32_t j = 0; valid && j < lodCount; j++)
+        {
+            MeshLod lod;
+            valid = reader.read(lod.error) && reader.readArray(lod.indices);
+            mesh.lods.push_back(std::move(lod));
+        }
+        valid = valid && reader.readArray(mesh.meshlets) && reader.read(textureCount);
+        for (uint32_t j = 0; valid && j < textureCount; j++)
+        {
+            CachedTexture texture;
+            valid = reader.readString(texture.type) && reader.readString(texture.path);
+            mesh.textures.push_back(texture);
+        }
+    }
+
+    if (!valid)
+    {
+        Misses++;
+        return false;
+    }
+
+    meshes = std::move(result);
+    Hits++;
+    return true;
+}
+
+// writes the meshes of a freshly imported model to its cache file
+bool MeshCache::Save(std::string const& path, unsigned int flags, unsigned int processing,
+    std::vector<std::string> const& dependencies, std::vector<Mesh> const& meshes)
+{
+    int64_t modified;
+    if (!sourceTime(path, modified))
+        return false;
+
+    // write to a temporary file first so a crash never leaves a half written cache behind
+    std::string cachePath = CachePath(path);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::MESHCACHE::FILE_NOT_WRITABLE " << cachePath << std::endl;
+            return false;
+        }
+
+        out.write(MAGIC, sizeof(MAGIC));
+        write(out, static_cast<uint32_t>(MESH_CACHE_VERSION));
+        write(out, static_cast<uint32_t>(sizeof(Vertex)));
+        write(out, static_cast<uint32_t>(flags));
+        write(out, static_cast<uint32_t>(processing));
+        write(out, modified);
+        writeString(out, path);
+        write(out, static_cast<uint32_t>(dependencies.size()));
+        for (std::string const& dependency : dependencies)
+        {
+            writeString(out, dependency);
+            write(out, dependencyTime(dependency));
+        }
+
+        write(out, static_cast<uint32_t>(meshes.size()));
+        for (const Mesh& mesh : meshes)
+        {
+            writeArray(out, mesh.vertices);
+            writeArray(out, mesh.indices);
+            write(out, static_cast<uint32_t>(mesh.lods.size()));
+            for (const MeshLod& lod : mesh.lods)
+            {
+                write(out, lod.error);
+                writeArray(out, lod.indices);
+            }
+            writeArray(out, mesh.meshlets);
+            write(out, static_cast<uint32_t>(mesh.textures.size()));
+            for (const Texture& texture : mesh.textures)
+            {
+                writeString(out, texture.type);
+                writeString(out, texture.path);
+            }
+        }
+
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    return !ec;
+}
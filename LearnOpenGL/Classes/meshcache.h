@@ -0,0 +1,48 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "mesh.h"
+
+#include <string>
+#include <vector>
+
+// bump whenever the layout of the cache file or of the cached mesh data changes
+const unsigned int MESH_CACHE_VERSION = 5;
+
+// texture reference as found in the model's material, resolved again on load
+struct CachedTexture {
+    std::string type;
+    std::string path;
+};
+
+// flattened mesh data as produced by Model::processMesh
+struct CachedMesh {
+    std::vector<Vertex>        vertices;
+    std::vector<unsigned int>  indices;
+    std::vector<MeshLod>       lods;
+    std::vector<Meshlet>       meshlets;
+    std::vector<CachedTexture> textures;
+};
+
+class MeshCache
+{
+public:
+    // number of model loads served from / missed by the cache since startup
+    static unsigned int Hits;
+    static unsigned int Misses;
+
+    // returns the path of the cache file that belongs to a model file
+    static std::string CachePath(std::string const& path);
+
+    // memory-maps the cache file of a model and reads back its meshes. Returns false on a miss (no cache file,
+    // source file or one of its dependencies modified, other Assimp post-process flags or import processing steps,
+    // older cache version)
+    static bool Load(std::string const& path, unsigned int flags, unsigned int processing, std::vector<CachedMesh>& meshes);
+
+    // writes the meshes of a freshly imported model to its cache file. dependencies are the other files the meshes
+    // were built from (material libraries, textures), their paths and modification times become part of the key
+    static bool Save(std::string const& path, unsigned int flags, unsigned int processing,
+        std::vector<std::string> const& dependencies, std::vector<Mesh> const& meshes);
+};
+
+#endif
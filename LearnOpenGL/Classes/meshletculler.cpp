@@ -0,0 +1,96 @@
+#include "meshletculler.h"
+
+#include <cstdint>
+
+// constructor
+MeshletCuller::MeshletCuller()
+{
+    Stats = MeshletStats{ 0, 0, 0, 0, 0, 0 };
+    viewPosition = glm::vec3(0.0f);
+    backfaceCulling = false;
+}
+
+// starts a frame with the world space frustum and eye position
+void MeshletCuller::Begin(Frustum const& frustum, glm::vec3 const& viewPosition, bool backfaceCulling)
+{
+    this->frustum = frustum;
+    this->viewPosition = viewPosition;
+    this->backfaceCulling = backfaceCulling;
+    Stats = MeshletStats{ 0, 0, 0, 0, 0, 0 };
+}
+
+// culls the meshlets of mesh under model
+GLsizei MeshletCuller::Cull(Mesh const& mesh, glm::mat4 const& model)
+{
+    counts.clear();
+    offsets.clear();
+    baseVertices.clear();
+
+    glm::mat3 normalMatrix = Shader::NormalMatrix(model);
+    size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t nextIndex = 0;
+    for (Meshlet const& meshlet : mesh.meshlets)
+    {
+        Stats.meshlets++;
+        Stats.trianglesTested += meshlet.triangleCount;
+
+        if (!frustum.Intersects(TransformSphere(meshlet.bounds, model)))
+        {
+            Stats.frustumCulled++;
+            continue;
+        }
+
+        // every triangle faces away if the eye lies inside the cone opening behind the apex
+        if (backfaceCulling && meshlet.coneCutoff <= 1.0f)
+        {
+            glm::vec3 apex = glm::vec3(model * glm::vec4(meshlet.coneApex, 1.0f));
+            glm::vec3 axis = glm::normalize(normalMatrix * meshlet.coneAxis);
+            glm::vec3 toApex = apex - viewPosition;
+            float length = glm::length(toApex);
+            if (length > 0.0f && glm::dot(toApex / length, axis) >= meshlet.coneCutoff)
+            {
+                Stats.backfaceCulled++;
+                continue;
+            }
+        }
+
+        Stats.trianglesVisible += meshlet.triangleCount;
+        GLsizei count = static_cast<GLsizei>(meshlet.triangleCount * 3);
+        if (!counts.empty() && nextIndex == meshlet.firstIndex)
+            counts.back() += count;
+        else
+        {
+            counts.push_back(count);
+            offsets.push_back(reinterpret_cast<const void*>(mesh.LodIndexOffset(0) + meshlet.firstIndex * indexSize));
+            baseVertices.push_back(mesh.baseVertex);
+        }
+        nextIndex = meshlet.firstIndex + meshlet.triangleCount * 3;
+    }
+
+    Stats.ranges += static_cast<unsigned int>(counts.size());
+    return static_cast<GLsizei>(counts.size());
+}
+
+// number of index ranges of the last Cull
+GLsizei MeshletCuller::Ranges() const
+{
+    return static_cast<GLsizei>(counts.size());
+}
+
+// index count of every range
+GLsizei const* MeshletCuller::Counts() const
+{
+    return counts.data();
+}
+
+// byte offset of every range in the GeometryArena index buffer
+const void* const* MeshletCuller::Offsets() const
+{
+    return offsets.data();
+}
+
+// base vertex of every range, all the mesh's
+GLint const* MeshletCuller::BaseVertices() const
+{
+    return baseVertices.data();
+}
@@ -0,0 +1,68 @@
+#ifndef MESHLETCULLER_H
+#define MESHLETCULLER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "mesh.h"
+
+#include <cstddef>
+#include <vector>
+
+// counters of every Cull since the last Begin
+struct MeshletStats {
+    unsigned int meshlets;       // tested
+    unsigned int frustumCulled;  // bounding sphere outside the frustum
+    unsigned int backfaceCulled; // normal cone facing away from the eye
+    size_t trianglesTested;
+    size_t trianglesVisible;
+    unsigned int ranges;         // index ranges drawn after merging neighbouring visible meshlets
+};
+
+// Culls the meshlets of a mesh (see BuildMeshlets) one by one on the CPU: the bounding sphere against the view
+// frustum and the normal cone against the eye position, so clusters entirely outside the view or entirely facing
+// away are never submitted. Visible meshlets that follow each other in the index buffer are merged into one
+// range, and Mesh::DrawMeshlets draws all ranges of a mesh with one glMultiDrawElementsBaseVertex.
+//
+//   meshletCuller.Begin(camera.GetFrustum(projection), camera.Position, glIsEnabled(GL_CULL_FACE));
+//   meshletCuller.Cull(mesh, model);
+//   mesh.DrawMeshlets(shader, meshletCuller);
+//
+// The cone test is exact for rotations, translations and uniform scale. It only runs when the rasterizer culls back
+// faces as well, otherwise a cluster facing away is still drawn and culling it would change the image.
+class MeshletCuller
+{
+public:
+    // counters since the last Begin
+    MeshletStats Stats;
+
+    // constructor
+    MeshletCuller();
+
+    // starts a frame with the world space frustum and eye position and clears Stats. backfaceCulling tells whether
+    // GL_CULL_FACE is enabled (culling back faces) for the draws, the normal cone test is skipped otherwise
+    void Begin(Frustum const& frustum, glm::vec3 const& viewPosition, bool backfaceCulling);
+
+    // culls the meshlets of mesh under model and returns the number of index ranges left to draw
+    GLsizei Cull(Mesh const& mesh, glm::mat4 const& model);
+
+    // index counts, byte offsets into the GeometryArena index buffer and base vertices of the ranges of the
+    // last Cull, as glMultiDrawElementsBaseVertex takes them
+    GLsizei Ranges() const;
+    GLsizei const* Counts() const;
+    const void* const* Offsets() const;
+    GLint const* BaseVertices() const;
+
+private:
+    Frustum frustum;
+    glm::vec3 viewPosition;
+    bool backfaceCulling;
+
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+};
+
+#endif
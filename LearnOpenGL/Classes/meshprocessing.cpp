@@ -0,0 +1,792 @@
+#include "meshprocessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+
+// splits a triangle list into parts of at most maxVertices vertices each
+std::vector<MeshPart> SplitMesh(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices, size_t maxVertices)
+{
+    std::vector<MeshPart> parts;
+    if (maxVertices < 3)
+        return parts;
+
+    // original vertex -> index inside the current part, valid while partOf matches the part number
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<uint32_t> partOf(vertices.size(), UINT32_MAX);
+
+    MeshPart part;
+    uint32_t partNumber = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        // count the vertices this triangle would add, start a new part if they do not fit
+        unsigned int added = 0;
+        for (size_t j = 0; j < 3; j++)
+        {
+            unsigned int index = indices[i + j];
+            bool repeated = (j > 0 && indices[i] == index) || (j > 1 && indices[i + 1] == index);
+            if (partOf[index] != partNumber && !repeated)
+                added++;
+        }
+        if (part.vertices.size() + added > maxVertices)
+        {
+            parts.push_back(std::move(part));
+            part = MeshPart();
+            partNumber++;
+        }
+
+        for (size_t j = 0; j < 3; j++)
+        {
+            unsigned int index = indices[i + j];
+            if (partOf[index] != partNumber)
+            {
+                partOf[index] = partNumber;
+                remap[index] = static_cast<unsigned int>(part.vertices.size());
+                part.vertices.push_back(vertices[index]);
+            }
+            part.indices.push_back(remap[index]);
+        }
+    }
+    if (!part.indices.empty())
+        parts.push_back(std::move(part));
+    return parts;
+}
+
+// simulates a FIFO post-transform cache of cacheSize entries over the triangle list
+VertexCacheStats AnalyzeVertexCache(std::vector<unsigned int> const& indices, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (indices.size() < 3)
+        return stats;
+
+    // a vertex is in the FIFO while fewer than cacheSize misses happened since it was inserted
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t unique = 0;
+    for (unsigned int index : indices)
+    {
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            unique++;
+        }
+        if (insertedAt[index] == 0 || misses + 1 - insertedAt[index] > cacheSize)
+        {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / unique;
+    return stats;
+}
+
+// reorders triangles for the post-transform vertex cache (Tipsify)
+std::vector<unsigned int> OptimizeVertexCache(std::vector<unsigned int> const& indices, size_t vertexCount, unsigned int cacheSize, std::vector<unsigned int>* clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    if (clusters)
+        clusters->clear();
+
+    // vertex -> triangle adjacency, stored as offsets into one array
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        liveTriangles[indices[i]]++;
+
+    std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+    // cache time stamp per vertex, emitted flag per triangle, dead-end stack of recently used vertices
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0;
+    long long fanning = vertexCount > 0 && triangleCount > 0 ? 0 : -1;
+    bool restarted = true;
+
+    while (fanning >= 0)
+    {
+        unsigned int vertex = static_cast<unsigned int>(fanning);
+        candidates.clear();
+
+        // emit every remaining triangle around the fanning vertex
+        for (unsigned int a = adjacencyOffset[vertex]; a < adjacencyOffset[vertex + 1]; a++)
+        {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            if (restarted && clusters)
+                clusters->push_back(static_cast<unsigned int>(result.size() / 3));
+            restarted = false;
+
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time;
+                    time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // next fanning vertex: the candidate still in the cache that stays there the longest
+        long long next = -1;
+        long long bestPriority = -1;
+        for (unsigned int v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+            long long priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        // dead end: fall back to recently used vertices, then to the next vertex in input order
+        if (next == -1)
+        {
+            restarted = true;
+            while (!deadEnd.empty() && next == -1)
+            {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0)
+                    next = v;
+            }
+            while (next == -1 && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                    next = static_cast<long long>(cursor);
+                cursor++;
+            }
+        }
+        fanning = next;
+    }
+    return result;
+}
+
+// reorders the clusters of a cache optimized triangle list so outward facing clusters are drawn first
+std::vector<unsigned int> OptimizeOverdraw(std::vector<unsigned int> const& indices, std::vector<Vertex> const& vertices, std::vector<unsigned int> const& clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (clusters.size() < 2)
+        return indices;
+
+    // area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        glm::vec3 p0 = vertices[indices[t * 3 + 0]].Position;
+        glm::vec3 p1 = vertices[indices[t * 3 + 1]].Position;
+        glm::vec3 p2 = vertices[indices[t * 3 + 2]].Position;
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // how much each cluster faces away from the mesh center
+    std::vector<float> sortKey(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = begin; t < end; t++)
+        {
+            glm::vec3 p0 = vertices[indices[t * 3 + 0]].Position;
+            glm::vec3 p1 = vertices[indices[t * 3 + 1]].Position;
+            glm::vec3 p2 = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(areaNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += areaNormal;
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float normalLength = glm::length(normal);
+        sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<unsigned int> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (unsigned int c : order)
+    {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+    }
+    return result;
+}
+
+// orders vertices by first use in the index buffer so vertex fetches walk memory linearly
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int unused = UINT32_MAX;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reordered);
+}
+
+namespace
+{
+    // symmetric 4x4 error quadric of a set of planes: the sum of squared distances of a point to all of them
+    struct Quadric {
+        double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+
+        // adds the plane dot(normal, p) + distance = 0, normal of unit length
+        void addPlane(glm::dvec3 const& normal, double distance)
+        {
+            xx += normal.x * normal.x; xy += normal.x * normal.y; xz += normal.x * normal.z; xw += normal.x * distance;
+            yy += normal.y * normal.y; yz += normal.y * normal.z; yw += normal.y * distance;
+            zz += normal.z * normal.z; zw += normal.z * distance;
+            ww += distance * distance;
+        }
+
+        void add(Quadric const& other)
+        {
+            xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+            yy += other.yy; yz += other.yz; yw += other.yw;
+            zz += other.zz; zw += other.zw;
+            ww += other.ww;
+        }
+
+        // sum of squared plane distances of p
+        double evaluate(glm::vec3 const& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double error = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+                + yy * y * y + 2 * yz * y * z + 2 * yw * y
+                + zz * z * z + 2 * zw * z
+                + ww;
+            return std::max(error, 0.0);
+        }
+    };
+
+    // byte key of a whole vertex or only its position, so exactly equal values compare equal
+    std::string vertexKey(Vertex const& vertex, bool positionOnly)
+    {
+        size_t size = positionOnly ? sizeof(glm::vec3) : sizeof(Vertex);
+        std::string key(size, '\0');
+        std::memcpy(&key[0], positionOnly ? static_cast<const void*>(&vertex.Position) : static_cast<const void*>(&vertex), size);
+        return key;
+    }
+
+    // geometric normal of a triangle, not normalized
+    glm::vec3 triangleNormal(glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c)
+    {
+        return glm::cross(b - a, c - a);
+    }
+
+    // distance of p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+    float triangleDistance(glm::vec3 const& p, glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c)
+    {
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return glm::length(p - a);
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return glm::length(p - b);
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return glm::length(p - c);
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+            return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+        float denominator = va + vb + vc;
+        if (denominator <= 0.0f)
+            return std::min(glm::length(p - a), std::min(glm::length(p - b), glm::length(p - c)));
+        return glm::length(p - (a + ab * (vb / denominator) + ac * (vc / denominator)));
+    }
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+}
+
+// simplifies a triangle list by quadric error edge collapse
+std::vector<unsigned int> SimplifyMesh(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices, size_t targetIndexCount, float* error)
+{
+    // vertices identical in every attribute are one vertex to the simplifier, e.g. unwelded OBJ corners
+    std::vector<unsigned int> canonical(vertices.size());
+    std::vector<unsigned int> positionOf(vertices.size());
+    std::vector<unsigned int> wedges; // distinct vertices per position
+    {
+        std::unordered_map<std::string, unsigned int> firstVertex;
+        std::unordered_map<std::string, unsigned int> positions;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            auto vertex = firstVertex.emplace(vertexKey(vertices[i], false), i);
+            canonical[i] = vertex.first->second;
+            auto position = positions.emplace(vertexKey(vertices[i], true), static_cast<unsigned int>(positions.size()));
+            positionOf[i] = position.first->second;
+            if (position.second)
+                wedges.push_back(0);
+            if (vertex.second)
+                wedges[positionOf[i]]++;
+        }
+    }
+
+    std::vector<unsigned int> triangles;
+    triangles.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        for (size_t j = 0; j < 3; j++)
+            triangles.push_back(canonical[indices[i + j]]);
+
+    // seams keep every wedge, borders and non-manifold edges (a position edge not used by exactly two triangles)
+    // keep the outline
+    std::vector<uint8_t> locked(vertices.size(), 0);
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (size_t j = 0; j < 3; j++)
+            {
+                uint64_t a = positionOf[triangles[i + j]], b = positionOf[triangles[i + (j + 1) % 3]];
+                edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+            }
+        }
+        std::vector<uint8_t> lockedPosition(wedges.size(), 0);
+        for (auto const& edge : edgeUses)
+        {
+            if (edge.second != 2)
+            {
+                lockedPosition[edge.first >> 32] = 1;
+                lockedPosition[edge.first & 0xffffffff] = 1;
+            }
+        }
+        for (unsigned int i = 0; i < vertices.size(); i++)
+            locked[i] = wedges[positionOf[i]] > 1 || lockedPosition[positionOf[i]];
+    }
+
+    // one quadric per position, so all wedges of a seam see the same error
+    std::vector<Quadric> quadrics(wedges.size());
+    for (size_t i = 0; i < triangles.size(); i += 3)
+    {
+        glm::dvec3 a = vertices[triangles[i]].Position, b = vertices[triangles[i + 1]].Position, c = vertices[triangles[i + 2]].Position;
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+        normal /= length;
+        Quadric plane;
+        plane.addPlane(normal, -glm::dot(normal, a));
+        for (size_t j = 0; j < 3; j++)
+            quadrics[positionOf[triangles[i + j]]].add(plane);
+    }
+
+    // vertex -> vertex it was collapsed onto, followed to the end by resolve
+    std::vector<unsigned int> remap(vertices.size());
+    std::iota(remap.begin(), remap.end(), 0);
+    auto resolve = [&](unsigned int vertex)
+    {
+        while (remap[vertex] != vertex)
+            vertex = remap[vertex] = remap[remap[vertex]];
+        return vertex;
+    };
+
+    // passes of independent collapses, cheapest first, until the target is met or nothing can collapse
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(vertices.size());
+    std::vector<unsigned int> triangleStart(vertices.size() + 1), vertexTriangles;
+    while (triangles.size() > targetIndexCount)
+    {
+        // every directed edge out of an unlocked vertex
+        collapses.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (size_t j = 0; j < 3; j++)
+            {
+                unsigned int from = triangles[i + j], to = triangles[i + (j + 1) % 3];
+                for (int direction = 0; direction < 2; direction++, std::swap(from, to))
+                {
+                    if (locked[from])
+                        continue;
+                    Quadric merged = quadrics[positionOf[from]];
+                    merged.add(quadrics[positionOf[to]]);
+                    collapses.push_back(Collapse{ from, to, merged.evaluate(vertices[to].Position) });
+                }
+            }
+        }
+        if (collapses.empty())
+            break;
+        std::sort(collapses.begin(), collapses.end(), [](Collapse const& a, Collapse const& b)
+        {
+            return a.cost < b.cost || (a.cost == b.cost && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+        });
+
+        // triangles around every vertex, for the flip test
+        std::fill(triangleStart.begin(), triangleStart.end(), 0);
+        for (unsigned int vertex : triangles)
+            triangleStart[vertex + 1]++;
+        std::partial_sum(triangleStart.begin(), triangleStart.end(), triangleStart.begin());
+        vertexTriangles.resize(triangles.size());
+        {
+            std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+            for (size_t i = 0; i < triangles.size(); i++)
+                vertexTriangles[fill[triangles[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // each collapse removes about two triangles, stop the pass once that reaches the target
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t triangleCount = triangles.size() / 3;
+        size_t targetTriangles = targetIndexCount / 3;
+        size_t removed = 0;
+        bool collapsed = false;
+        for (Collapse const& collapse : collapses)
+        {
+            if (triangleCount - removed <= targetTriangles)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // reject collapses that would turn a remaining triangle around u over
+            glm::vec3 target = vertices[collapse.to].Position;
+            bool flips = false;
+            unsigned int sharing = 0;
+            for (unsigned int t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1] && !flips; t++)
+            {
+                unsigned int triangle = vertexTriangles[t];
+                unsigned int corners[3];
+                for (size_t j = 0; j < 3; j++)
+                    corners[j] = resolve(triangles[3 * triangle + j]);
+                if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+                    continue;
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                {
+                    sharing++;
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                for (size_t j = 0; j < 3; j++)
+                {
+                    before[j] = vertices[corners[j]].Position;
+                    after[j] = corners[j] == collapse.from ? target : before[j];
+                }
+                glm::vec3 oldNormal = triangleNormal(before[0], before[1], before[2]);
+                glm::vec3 newNormal = triangleNormal(after[0], after[1], after[2]);
+                flips = glm::dot(oldNormal, newNormal) <= 0.25f * glm::length(oldNormal) * glm::length(newNormal);
+            }
+            if (flips)
+                continue;
+
+            // the flip test above only holds while the ring around from stays where it is
+            remap[collapse.from] = collapse.to;
+            quadrics[positionOf[collapse.to]].add(quadrics[positionOf[collapse.from]]);
+            for (unsigned int t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1]; t++)
+                for (size_t j = 0; j < 3; j++)
+                    touched[resolve(triangles[3 * vertexTriangles[t] + j])] = 1;
+            touched[collapse.from] = touched[collapse.to] = 1;
+            removed += std::max(sharing, 1u);
+            collapsed = true;
+        }
+        if (!collapsed)
+            break;
+
+        // rewrite the triangles, dropping the ones that collapsed to a line or a point
+        size_t kept = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            unsigned int a = resolve(triangles[i]), b = resolve(triangles[i + 1]), c = resolve(triangles[i + 2]);
+            if (a == b || b == c || c == a || positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[c] == positionOf[a])
+                continue;
+            triangles[kept++] = a;
+            triangles[kept++] = b;
+            triangles[kept++] = c;
+        }
+        triangles.resize(kept);
+    }
+
+    // error: the largest distance of an original vertex to the simplified triangles around the vertex it ended
+    // up collapsed onto, to the closest point of the closest one. The distance to a triangle's plane would miss
+    // every offset past the triangle's edges
+    if (error)
+    {
+        std::fill(triangleStart.begin(), triangleStart.end(), 0);
+        for (unsigned int vertex : triangles)
+            triangleStart[vertex + 1]++;
+        std::partial_sum(triangleStart.begin(), triangleStart.end(), triangleStart.begin());
+        vertexTriangles.resize(triangles.size());
+        std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+        for (size_t i = 0; i < triangles.size(); i++)
+            vertexTriangles[fill[triangles[i]]++] = static_cast<unsigned int>(i / 3);
+
+        float largest = 0.0f;
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int vertex = canonical[indices[i]];
+            unsigned int target = resolve(vertex);
+            if (target == vertex || triangleStart[target] == triangleStart[target + 1])
+                continue;
+            glm::vec3 position = vertices[vertex].Position;
+            float closest = std::numeric_limits<float>::max();
+            for (unsigned int t = triangleStart[target]; t < triangleStart[target + 1]; t++)
+            {
+                unsigned int const* corners = &triangles[3 * vertexTriangles[t]];
+                closest = std::min(closest, triangleDistance(position, vertices[corners[0]].Position, vertices[corners[1]].Position, vertices[corners[2]].Position));
+            }
+            largest = std::max(largest, closest);
+        }
+        *error = largest;
+    }
+    return triangles;
+}
+
+// groups the triangles into meshlets and reorders indices so every meshlet is one contiguous range
+std::vector<Meshlet> BuildMeshlets(std::vector<Vertex> const& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+    size_t triangleCount = indices.size() / 3;
+
+    // triangles around every vertex
+    std::vector<unsigned int> triangleStart(vertices.size() + 1, 0), vertexTriangles(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        triangleStart[indices[i] + 1]++;
+    std::partial_sum(triangleStart.begin(), triangleStart.end(), triangleStart.begin());
+    {
+        std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            vertexTriangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<Meshlet> meshlets;
+    std::vector<unsigned int> reordered;
+    reordered.reserve(triangleCount * 3);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<unsigned int> vertexMeshlet(vertices.size(), NONE);    // meshlet that already uses a vertex
+    std::vector<unsigned int> candidateMeshlet(triangleCount, NONE);   // meshlet a triangle is a candidate of
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> meshletTriangles;
+    std::vector<glm::vec3> positions;
+    glm::vec3 positionSum(0.0f);
+    size_t seed = 0;
+
+    Meshlet meshlet = Meshlet();
+    meshlet.firstIndex = 0;
+    unsigned int id = 0;
+
+    // closes the current meshlet: bounds, normal cone, then starts the next one
+    auto finish = [&]()
+    {
+        // the triangles keep their relative order from indices, so the order of OptimizeVertexCache survives
+        // within every meshlet
+        std::sort(meshletTriangles.begin(), meshletTriangles.end());
+        for (unsigned int triangle : meshletTriangles)
+            for (size_t j = 0; j < 3; j++)
+                reordered.push_back(indices[3 * triangle + j]);
+        meshletTriangles.clear();
+
+        meshlet.bounds = ComputeBoundingSphere(positions.data(), positions.size());
+
+        glm::vec3 normalSum(0.0f);
+        for (size_t i = meshlet.firstIndex; i < reordered.size(); i += 3)
+        {
+            glm::vec3 normal = triangleNormal(vertices[reordered[i]].Position, vertices[reordered[i + 1]].Position, vertices[reordered[i + 2]].Position);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+                normalSum += normal / length;
+        }
+        float axisLength = glm::length(normalSum);
+        meshlet.coneAxis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneApex = meshlet.bounds.center;
+        meshlet.coneCutoff = 2.0f;
+
+        // the cone holds every normal, the apex sits behind every triangle's plane
+        float smallestDot = axisLength > 0.0f ? 1.0f : -1.0f;
+        for (size_t i = meshlet.firstIndex; i < reordered.size() && smallestDot > 0.0f; i += 3)
+        {
+            glm::vec3 normal = triangleNormal(vertices[reordered[i]].Position, vertices[reordered[i + 1]].Position, vertices[reordered[i + 2]].Position);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+                smallestDot = std::min(smallestDot, glm::dot(normal / length, meshlet.coneAxis));
+        }
+        if (smallestDot > 0.0f)
+        {
+            float apexDistance = 0.0f;
+            for (size_t i = meshlet.firstIndex; i < reordered.size(); i += 3)
+            {
+                glm::vec3 corner = vertices[reordered[i]].Position;
+                glm::vec3 normal = triangleNormal(corner, vertices[reordered[i + 1]].Position, vertices[reordered[i + 2]].Position);
+                float length = glm::length(normal);
+                if (length == 0.0f)
+                    continue;
+                normal /= length;
+                apexDistance = std::max(apexDistance, glm::dot(meshlet.bounds.center - corner, normal) / glm::dot(meshlet.coneAxis, normal));
+            }
+            meshlet.coneApex = meshlet.bounds.center - meshlet.coneAxis * apexDistance;
+            meshlet.coneCutoff = std::sqrt(std::max(1.0f - smallestDot * smallestDot, 0.0f));
+        }
+
+        meshlets.push_back(meshlet);
+        meshlet = Meshlet();
+        meshlet.firstIndex = static_cast<unsigned int>(reordered.size());
+        id++;
+        candidates.clear();
+        positions.clear();
+        positionSum = glm::vec3(0.0f);
+    };
+
+    auto newVertices = [&](unsigned int triangle)
+    {
+        unsigned int count = 0;
+        for (size_t j = 0; j < 3; j++)
+            count += vertexMeshlet[indices[3 * triangle + j]] != id;
+        return count;
+    };
+
+    while (true)
+    {
+        // the candidate adding the fewest vertices, then the one closest to the meshlet's centre
+        unsigned int best = NONE;
+        unsigned int bestNew = 4;
+        float bestDistance = 0.0f;
+        glm::vec3 centre = positions.empty() ? glm::vec3(0.0f) : positionSum / float(positions.size());
+        size_t kept = 0;
+        for (unsigned int triangle : candidates)
+        {
+            if (emitted[triangle])
+                continue;
+            candidates[kept++] = triangle;
+            unsigned int added = newVertices(triangle);
+            if (meshlet.vertexCount + added > MAX_MESHLET_VERTICES)
+                continue;
+            glm::vec3 triangleCentre = (vertices[indices[3 * triangle]].Position + vertices[indices[3 * triangle + 1]].Position
+                + vertices[indices[3 * triangle + 2]].Position) / 3.0f;
+            float distance = glm::dot(triangleCentre - centre, triangleCentre - centre);
+            if (added < bestNew || (added == bestNew && distance < bestDistance))
+            {
+                best = triangle;
+                bestNew = added;
+                bestDistance = distance;
+            }
+        }
+        candidates.resize(kept);
+
+        // nothing connected fits: close the meshlet, or seed a new one with the first triangle left
+        if (best == NONE)
+        {
+            if (meshlet.triangleCount > 0)
+            {
+                finish();
+                continue;
+            }
+            while (seed < triangleCount && emitted[seed])
+                seed++;
+            if (seed == triangleCount)
+                break;
+            best = static_cast<unsigned int>(seed);
+        }
+
+        emitted[best] = 1;
+        meshlet.triangleCount++;
+        meshletTriangles.push_back(best);
+        for (size_t j = 0; j < 3; j++)
+        {
+            unsigned int vertex = indices[3 * best + j];
+            if (vertexMeshlet[vertex] != id)
+            {
+                vertexMeshlet[vertex] = id;
+                meshlet.vertexCount++;
+                positions.push_back(vertices[vertex].Position);
+                positionSum += vertices[vertex].Position;
+            }
+            for (unsigned int t = triangleStart[vertex]; t < triangleStart[vertex + 1]; t++)
+            {
+                unsigned int neighbour = vertexTriangles[t];
+                if (!emitted[neighbour] && candidateMeshlet[neighbour] != id)
+                {
+                    candidateMeshlet[neighbour] = id;
+                    candidates.push_back(neighbour);
+                }
+            }
+        }
+
+        if (meshlet.triangleCount == MAX_MESHLET_TRIANGLES)
+            finish();
+    }
+    if (meshlet.triangleCount > 0)
+        finish();
+
+    indices = std::move(reordered);
+    return meshlets;
+}
+
+// up to MAX_MESH_LODS - 1 coarser index buffers, each with about half the triangles of the one before
+std::vector<MeshLod> GenerateLods(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices)
+{
+    std::vector<MeshLod> lods;
+    size_t previous = indices.size();
+    for (unsigned int level = 1; level < MAX_MESH_LODS; level++)
+    {
+        // every level starts from the full mesh, so its error is measured against the original surface
+        MeshLod lod;
+        size_t target = previous / 2 / 3 * 3;
+        lod.indices = SimplifyMesh(vertices, indices, target, &lod.error);
+        if (lod.indices.empty() || lod.indices.size() > previous * 9 / 10)
+            break;
+        previous = lod.indices.size();
+        lods.push_back(std::move(lod));
+    }
+    return lods;
+}
@@ -0,0 +1,70 @@
+#ifndef MESHPROCESSING_H
+#define MESHPROCESSING_H
+
+#include "mesh.h"
+
+#include <cstddef>
+#include <vector>
+
+// Import-time processing of flattened mesh data, run by Model::processMesh before Mesh construction.
+
+// largest vertex count whose indices still fit into GL_UNSIGNED_SHORT
+const size_t MAX_16BIT_VERTICES = 65536;
+
+// a piece of a split mesh with its own, compact vertex array
+struct MeshPart {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// splits a triangle list into parts of at most maxVertices vertices each, so every part can be drawn with
+// 16-bit indices. Vertices shared by triangles of different parts are duplicated
+std::vector<MeshPart> SplitMesh(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices, size_t maxVertices = MAX_16BIT_VERTICES);
+
+// post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+    float acmr; // average cache miss ratio: transformed vertices per triangle (0.5 is ideal for large grids, 3 the worst)
+    float atvr; // average transform to vertex ratio: transformed vertices per referenced vertex (1 is ideal)
+};
+
+// size of the simulated / targeted post-transform vertex cache
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// simulates a FIFO post-transform cache of cacheSize entries over the triangle list
+VertexCacheStats AnalyzeVertexCache(std::vector<unsigned int> const& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// reorders triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007). If clusters is given it
+// receives the first triangle of every cluster, i.e. every point where the algorithm had to restart the cache
+std::vector<unsigned int> OptimizeVertexCache(std::vector<unsigned int> const& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE, std::vector<unsigned int>* clusters = nullptr);
+
+// reorders the clusters of a cache optimized triangle list so outward facing clusters are drawn first and
+// occlude the rest of the mesh. Triangle order inside a cluster, and so the cache efficiency, is kept
+std::vector<unsigned int> OptimizeOverdraw(std::vector<unsigned int> const& indices, std::vector<Vertex> const& vertices, std::vector<unsigned int> const& clusters);
+
+// orders vertices by first use in the index buffer so vertex fetches walk memory linearly. Unreferenced
+// vertices are dropped and indices are remapped
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// most levels of detail per mesh, the full mesh included
+const unsigned int MAX_MESH_LODS = 4;
+
+// simplifies a triangle list towards targetIndexCount indices by quadric error edge collapse (Garland and
+// Heckbert 1997) and returns the new index buffer over the same vertices. Vertices are only collapsed onto one
+// of their neighbours, never moved, so UVs and normals stay valid. Vertices on UV / normal seams (a position
+// shared by vertices with different attributes) and on open borders are locked, which keeps seams and mesh
+// outlines closed. error receives the largest distance of a removed vertex from the surface of the simplified
+// triangles around the vertex it was collapsed onto, in model units
+std::vector<unsigned int> SimplifyMesh(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices, size_t targetIndexCount, float* error = nullptr);
+
+// groups the triangles into meshlets of at most MAX_MESHLET_VERTICES vertices and MAX_MESHLET_TRIANGLES
+// triangles, grown greedily over shared vertices so they stay spatially compact, and reorders indices so every
+// meshlet is one contiguous range. Meshlets are seeded in index order and keep the order of their triangles, so
+// a vertex cache order from OptimizeVertexCache is kept within each of them. Each meshlet gets a bounding sphere
+// and a normal cone for backface culling
+std::vector<Meshlet> BuildMeshlets(std::vector<Vertex> const& vertices, std::vector<unsigned int>& indices);
+
+// up to MAX_MESH_LODS - 1 coarser index buffers, each with about half the triangles of the one before. Stops
+// early once simplification barely removes anything, e.g. when most vertices are locked
+std::vector<MeshLod> GenerateLods(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices);
+
+#endif
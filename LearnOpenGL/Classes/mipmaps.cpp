@@ -0,0 +1,233 @@
+#include "mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIPMAPS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAPS_SSE2
+#endif
+
+namespace
+{
+    // 8-bit value -> float in the space levels are averaged in, and back, per MipmapMode
+    struct ConversionTables {
+        float toLinear[256];
+        float toSigned[256];
+        // linear value in 1/65535 steps -> nearest sRGB value, fine enough to tell the darkest sRGB values apart
+        unsigned char fromLinear[65536];
+
+        ConversionTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                toSigned[i] = c * 2.0f - 1.0f;
+            }
+            for (int i = 0; i < 65536; i++)
+            {
+                float c = i / 65535.0f;
+                float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<unsigned char>(std::min(srgb * 255.0f + 0.5f, 255.0f));
+            }
+        }
+    };
+
+    // built once, on first use by any thread
+    ConversionTables const& tables()
+    {
+        static const ConversionTables instance;
+        return instance;
+    }
+
+    // channels of an image that hold sRGB color, alpha (the last channel of 2 and 4 channel images) stays linear
+    int colorChannels(int components)
+    {
+        return components == 2 ? 1 : std::min(components, 3);
+    }
+
+    // converts one row of pixels into one float row per channel, planes[c] starting at c * stride
+    void decodeRow(unsigned char const* row, int width, int components, MipmapMode mode, float* planes, size_t stride)
+    {
+        ConversionTables const& t = tables();
+        int converted = mode == MIPMAP_LINEAR ? 0 : mode == MIPMAP_SRGB ? colorChannels(components) : std::min(components, 3);
+        float const* table = mode == MIPMAP_SRGB ? t.toLinear : t.toSigned;
+        for (int c = 0; c < components; c++)
+        {
+            float* plane = planes + c * stride;
+            if (c < converted)
+                for (int x = 0; x < width; x++)
+                    plane[x] = table[row[x * components + c]];
+            else
+                for (int x = 0; x < width; x++)
+                    plane[x] = row[x * components + c] * (1.0f / 255.0f);
+        }
+    }
+
+    // converts float rows back into one row of pixels
+    void encodeRow(float const* planes, size_t stride, int width, int components, MipmapMode mode, unsigned char* row)
+    {
+        ConversionTables const& t = tables();
+        int converted = mode == MIPMAP_LINEAR ? 0 : mode == MIPMAP_SRGB ? colorChannels(components) : std::min(components, 3);
+        for (int c = 0; c < components; c++)
+        {
+            float const* plane = planes + c * stride;
+            if (c < converted && mode == MIPMAP_SRGB)
+            {
+                for (int x = 0; x < width; x++)
+                    row[x * components + c] = t.fromLinear[static_cast<int>(std::min(std::max(plane[x], 0.0f), 1.0f) * 65535.0f + 0.5f)];
+                continue;
+            }
+            // signed normal components map [-1, 1] back to [0, 1]
+            float scale = c < converted ? 0.5f : 1.0f;
+            float bias = c < converted ? 0.5f : 0.0f;
+            for (int x = 0; x < width; x++)
+                row[x * components + c] = static_cast<unsigned char>(std::min(std::max(plane[x] * scale + bias, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    // dst[x] = average of the 2x2 box at 2x in the rows a and b
+    void averageRows(float const* a, float const* b, int dstWidth, float* dst)
+    {
+        int x = 0;
+#if defined(MIPMAPS_AVX2)
+        __m256 quarter = _mm256_set1_ps(0.25f);
+        for (; x + 8 <= dstWidth; x += 8)
+        {
+            __m256 low = _mm256_add_ps(_mm256_loadu_ps(a + 2 * x), _mm256_loadu_ps(b + 2 * x));
+            __m256 high = _mm256_add_ps(_mm256_loadu_ps(a + 2 * x + 8), _mm256_loadu_ps(b + 2 * x + 8));
+            // the shuffles work within 128-bit lanes, which leaves the pairs of results in the order 0 2 1 3
+            __m256 even = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 odd = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+            __m256 sum = _mm256_mul_ps(_mm256_add_ps(even, odd), quarter);
+            sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+            _mm256_storeu_ps(dst + x, sum);
+        }
+#elif defined(MIPMAPS_SSE2)
+        __m128 quarter = _mm_set1_ps(0.25f);
+        for (; x + 4 <= dstWidth; x += 4)
+        {
+            __m128 low = _mm_add_ps(_mm_loadu_ps(a + 2 * x), _mm_loadu_ps(b + 2 * x));
+            __m128 high = _mm_add_ps(_mm_loadu_ps(a + 2 * x + 4), _mm_loadu_ps(b + 2 * x + 4));
+            __m128 even = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(dst + x, _mm_mul_ps(_mm_add_ps(even, odd), quarter));
+        }
+#endif
+        // summed in the same order as the SIMD lanes, so every instruction set builds the same levels
+        for (; x < dstWidth; x++)
+            dst[x] = ((a[2 * x] + b[2 * x]) + (a[2 * x + 1] + b[2 * x + 1])) * 0.25f;
+    }
+
+    // scales the vectors (x[i], y[i], z[i]) back to unit length, zero vectors stay zero
+    void renormalize(float* x, float* y, float* z, int count)
+    {
+        int i = 0;
+#if defined(MIPMAPS_AVX2)
+        __m256 tiny = _mm256_set1_ps(1e-12f);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+            __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+            __m256 length = _mm256_max_ps(_mm256_sqrt_ps(lengthSquared), tiny);
+            _mm256_storeu_ps(x + i, _mm256_div_ps(vx, length));
+            _mm256_storeu_ps(y + i, _mm256_div_ps(vy, length));
+            _mm256_storeu_ps(z + i, _mm256_div_ps(vz, length));
+        }
+#elif defined(MIPMAPS_SSE2)
+        __m128 tiny = _mm_set1_ps(1e-12f);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+            __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+            __m128 length = _mm_max_ps(_mm_sqrt_ps(lengthSquared), tiny);
+            _mm_storeu_ps(x + i, _mm_div_ps(vx, length));
+            _mm_storeu_ps(y + i, _mm_div_ps(vy, length));
+            _mm_storeu_ps(z + i, _mm_div_ps(vz, length));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            float length = std::max(std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]), 1e-12f);
+            x[i] /= length;
+            y[i] /= length;
+            z[i] /= length;
+        }
+    }
+
+    // the level below src, two source rows at a time
+    void downsample(unsigned char const* src, MipLevel const& srcLevel, MipLevel const& dstLevel, int components, MipmapMode mode, unsigned char* dst)
+    {
+        // a side of 1 pixel is not halved, its pixels are repeated to fill the box
+        int srcWidth = srcLevel.width;
+        int paddedWidth = std::max(srcWidth, 2);
+        size_t srcRowBytes = static_cast<size_t>(srcWidth) * components;
+        size_t dstRowBytes = static_cast<size_t>(dstLevel.width) * components;
+        std::vector<float> rows(2 * static_cast<size_t>(paddedWidth) * components);
+        std::vector<float> result(static_cast<size_t>(dstLevel.width) * components);
+        float* top = rows.data();
+        float* bottom = top + static_cast<size_t>(paddedWidth) * components;
+
+        for (int y = 0; y < dstLevel.height; y++)
+        {
+            int y0 = srcLevel.height > 1 ? 2 * y : y;
+            int y1 = srcLevel.height > 1 ? 2 * y + 1 : y;
+            decodeRow(src + y0 * srcRowBytes, srcWidth, components, mode, top, paddedWidth);
+            decodeRow(src + y1 * srcRowBytes, srcWidth, components, mode, bottom, paddedWidth);
+            for (int c = 0; c < components; c++)
+            {
+                float* a = top + c * paddedWidth;
+                float* b = bottom + c * paddedWidth;
+                if (srcWidth == 1)
+                {
+                    a[1] = a[0];
+                    b[1] = b[0];
+                }
+                averageRows(a, b, dstLevel.width, result.data() + c * dstLevel.width);
+            }
+            if (mode == MIPMAP_NORMALS && components >= 3)
+                renormalize(result.data(), result.data() + dstLevel.width, result.data() + 2 * dstLevel.width, dstLevel.width);
+            encodeRow(result.data(), dstLevel.width, dstLevel.width, components, mode, dst + y * dstRowBytes);
+        }
+    }
+}
+
+// the full mip chain of an image down to 1x1, the base level first
+void GenerateMipChain(unsigned char const* pixels, int width, int height, int components, MipmapMode mode,
+    std::vector<MipLevel>& levels, std::vector<unsigned char>& data)
+{
+    levels.clear();
+    size_t offset = 0;
+    while (true)
+    {
+        size_t size = static_cast<size_t>(width) * height * components;
+        levels.push_back(MipLevel{ width, height, offset, size });
+        offset += size;
+        if (width == 1 && height == 1)
+            break;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    data.resize(offset);
+    std::memcpy(data.data(), pixels, levels[0].size);
+    for (size_t i = 1; i < levels.size(); i++)
+        downsample(data.data() + levels[i - 1].offset, levels[i - 1], levels[i], components, mode, data.data() + levels[i].offset);
+}
+
+// the instruction set GenerateMipChain was compiled with
+const char* MipmapInstructionSet()
+{
+#if defined(MIPMAPS_AVX2)
+    return "AVX2";
+#elif defined(MIPMAPS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
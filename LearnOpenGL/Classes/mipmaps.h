@@ -0,0 +1,36 @@
+#ifndef MIPMAPS_H
+#define MIPMAPS_H
+
+#include <cstddef>
+#include <vector>
+
+// what the channels of an image hold, decides the color space its mip levels are averaged in
+enum MipmapMode {
+    // data such as specular or roughness maps, averaged as stored
+    MIPMAP_LINEAR,
+    // sRGB encoded color (alpha excepted), averaged in linear space and encoded again
+    MIPMAP_SRGB,
+    // tangent space normals in the first three channels, averaged as vectors and renormalized on every level
+    MIPMAP_NORMALS
+};
+
+// one level of a mip chain inside a buffer holding the whole chain
+struct MipLevel {
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// Builds the full mip chain of an 8-bit image down to 1x1 on the CPU, so it can run on a worker thread and the
+// levels can be cached or uploaded as they are instead of calling glGenerateMipmap on the GL thread. Every level
+// is a 2x2 box filter of the level above it (half its size rounded down), computed in float on planar rows with
+// AVX2 or SSE2 when the compiler targets them. levels receives the layout of data, the base level (a copy of
+// pixels) first, every level tightly packed
+void GenerateMipChain(unsigned char const* pixels, int width, int height, int components, MipmapMode mode,
+    std::vector<MipLevel>& levels, std::vector<unsigned char>& data);
+
+// "AVX2", "SSE2" or "scalar", whichever GenerateMipChain was compiled with
+const char* MipmapInstructionSet();
+
+#endif
@@ -1,35 +1,285 @@
 #include "model.h"
 
+namespace
+{
+    // Assimp file access that remembers every file the importer opened, e.g. the material library of an .obj
+    class RecordingIOSystem : public Assimp::DefaultIOSystem
+    {
+    public:
+        std::vector<std::string> opened;
+
+        Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override
+        {
+            Assimp::IOStream* stream = Assimp::DefaultIOSystem::Open(pFile, pMode);
+            if (stream)
+                opened.push_back(pFile);
+            return stream;
+        }
+    };
+}
+
 // constructor
-Model::Model(std::string const& path)
+Model::Model(std::string const& path, ModelOptions const& options)
 {
+    PROFILE_SCOPE(Profiler::Intern("Model::Load " + path));
+    this->options = options;
+    instanceBuffer = 0;
+    instanceBufferSize = 0;
+    drawScopeName = Profiler::Intern("Model::Draw " + path.substr(path.find_last_of('/') + 1));
     loadModel(path);
+    finishTextureUploads();
+
+    if (options.vertexFormat == VERTEX_FORMAT_PACKED)
+        reportVertexCompression(path);
+}
+
+// releases this model's references on the shared textures, its geometry in the arena and the instance buffer
+Model::~Model()
+{
+    // a deleted texture must not be uploaded any more, its name may be handed out again
+    for (unsigned int i = 0; i < textures_loaded.size(); i++)
+        if (TextureRegistry::Release(textures_loaded[i].id) && options.textureStreamer)
+            options.textureStreamer->Cancel(textures_loaded[i].id);
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].Release();
+    if (instanceBuffer != 0)
+        glDeleteBuffers(1, &instanceBuffer);
 }
 
 // draw every mesh in model
-void Model::Draw(Shader& shader)
+size_t Model::Draw(Shader& shader, FrustumCuller const* culler, size_t first)
+{
+    PROFILE_GPU_SCOPE(drawScopeName);
+    size_t triangles = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        if (!culler || culler->Visible(first + i))
+        {
+            meshes[i].Draw(shader, lodOf(i));
+            triangles += meshes[i].LodIndexCount(lodOf(i)) / 3;
+        }
+    return triangles;
+}
+
+// like Draw, but only the meshlets meshletCuller keeps
+size_t Model::DrawMeshlets(Shader& shader, MeshletCuller& meshletCuller, glm::mat4 const& model, FrustumCuller const* culler, size_t first)
+{
+    PROFILE_GPU_SCOPE(drawScopeName);
+    size_t triangles = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        if (culler && !culler->Visible(first + i))
+            continue;
+
+        // meshlets only cover the full mesh
+        if (meshes[i].meshlets.empty() || lodOf(i) != 0)
+        {
+            meshes[i].Draw(shader, lodOf(i));
+            triangles += meshes[i].LodIndexCount(lodOf(i)) / 3;
+            continue;
+        }
+
+        size_t visibleBefore = meshletCuller.Stats.trianglesVisible;
+        meshletCuller.Cull(meshes[i], model);
+        meshes[i].DrawMeshlets(shader, meshletCuller);
+        triangles += meshletCuller.Stats.trianglesVisible - visibleBefore;
+    }
+    return triangles;
+}
+
+// draw count instances of the model, one per model matrix
+size_t Model::DrawInstanced(Shader& shader, glm::mat4 const* transforms, size_t count)
 {
+    if (count == 0)
+        return 0;
+    PROFILE_GPU_SCOPE(drawScopeName);
+
+    // the normal matrix is computed once per instance here instead of once per vertex in shader.vert
+    instanceData.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        instanceData[i].Model = transforms[i];
+        instanceData[i].NormalMatrix = Shader::NormalMatrix(transforms[i]);
+    }
+
+    // orphan the previous contents so the driver does not wait for the last frame's draws
+    size_t bytes = count * sizeof(InstanceData);
+    if (instanceBuffer == 0)
+        glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    instanceBufferSize = std::max(instanceBufferSize, bytes);
+    glBufferData(GL_ARRAY_BUFFER, instanceBufferSize, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instanceData.data());
+
     for (unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+        meshes[i].DrawInstanced(shader, instanceBuffer, static_cast<GLsizei>(count));
+    return Triangles() * count;
+}
+
+// queue every mesh in model for the next IndirectRenderer::Flush
+size_t Model::Submit(IndirectRenderer& renderer, glm::mat4 const& model, FrustumCuller const* culler, size_t first)
+{
+    size_t triangles = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        if (!culler || culler->Visible(first + i))
+        {
+            renderer.Add(meshes[i], model, lodOf(i));
+            triangles += meshes[i].LodIndexCount(lodOf(i)) / 3;
+        }
+    return triangles;
+}
+
+// queue every mesh in model for the next RenderQueue::Flush
+size_t Model::Submit(RenderQueue& queue, Shader& shader, glm::mat4 const& model, float depth, FrustumCuller const* culler, size_t first)
+{
+    size_t triangles = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        if (!culler || culler->Visible(first + i))
+        {
+            queue.Add(shader, meshes[i], model, depth, lodOf(i));
+            triangles += meshes[i].LodIndexCount(lodOf(i)) / 3;
+        }
+    return triangles;
+}
+
+// picks the level of detail of every mesh under model seen from viewPosition
+void Model::SelectLods(glm::mat4 const& model, glm::vec3 const& viewPosition, float pixelsPerUnit, float maxPixelError)
+{
+    // errors are in model units, so measure the distance in model units as well
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    if (scale <= 0.0f)
+        scale = 1.0f;
+
+    selectedLods.resize(meshes.size());
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        // distance to the closest point of the bounding sphere, 0 when the camera is inside
+        BoundingSphere sphere = TransformSphere(meshes[i].boundingSphere, model);
+        float distance = std::max(glm::length(sphere.center - viewPosition) - sphere.radius, 0.0f) / scale;
+        selectedLods[i] = meshes[i].SelectLod(distance, pixelsPerUnit, maxPixelError);
+    }
+}
+
+// triangles of every mesh at full detail
+size_t Model::Triangles() const
+{
+    size_t triangles = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        triangles += meshes[i].indices.size() / 3;
+    return triangles;
+}
+
+// GPU memory of the textures this model uses, counting shared ones once
+TextureMemory Model::TextureMemoryUsed() const
+{
+    std::vector<unsigned int> ids;
+    for (unsigned int i = 0; i < textures_loaded.size(); i++)
+        ids.push_back(textures_loaded[i].id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    TextureMemory total = { 0, 0 };
+    for (unsigned int id : ids)
+    {
+        TextureMemory memory = TextureRegistry::Memory(id);
+        total.resident += memory.resident;
+        total.uncompressed += memory.uncompressed;
+    }
+    return total;
+}
+
+// model space box around every mesh
+BoundingBox Model::Bounds() const
+{
+    BoundingBox box;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        box = Union(box, meshes[i].boundingBox);
+    return box;
+}
+
+// adds the world space box of every mesh under model to culler
+size_t Model::AddBounds(FrustumCuller& culler, glm::mat4 const& model) const
+{
+    size_t first = culler.Size();
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        culler.Add(TransformBox(meshes[i].boundingBox, model));
+    return first;
+}
+
+// inserts the world space box of every mesh under model into bvh
+void Model::InsertBounds(SceneBvh& bvh, glm::mat4 const& model, std::vector<unsigned int>& objects) const
+{
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        objects.push_back(bvh.Insert(TransformBox(meshes[i].boundingBox, model)));
+}
+
+// moves the objects InsertBounds created to model
+void Model::UpdateBounds(SceneBvh& bvh, glm::mat4 const& model, std::vector<unsigned int> const& objects) const
+{
+    for (unsigned int i = 0; i < meshes.size() && i < objects.size(); i++)
+        bvh.Update(objects[i], TransformBox(meshes[i].boundingBox, model));
+}
+
+// rasterizes every mesh under model into the occlusion culler's depth buffer
+void Model::RasterizeOccluders(OcclusionCuller& occlusion, glm::mat4 const& model) const
+{
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        if (!meshes[i].vertices.empty())
+            occlusion.RasterizeOccluder(&meshes[i].vertices[0].Position, sizeof(Vertex), meshes[i].indices.data(), meshes[i].indices.size(), model);
 }
 
 // load model into Assimp Scene object
 void Model::loadModel(std::string const& path)
 {
-    // read 3D model with Assimp, set scene object
+    // retrieve directory path
+    directory = path.substr(0, path.find_last_of('/'));
+
+    // warm start: build the meshes straight from the binary mesh cache
+    std::vector<CachedMesh> cached;
+    if (MeshCache::Load(path, MODEL_IMPORT_FLAGS, processingFlags(), cached))
+    {
+        processCachedMeshes(cached);
+        return;
+    }
+
+    // read 3D model with Assimp, set scene object. The importer owns and deletes the IO handler
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    RecordingIOSystem* files = new RecordingIOSystem();
+    importer.SetIOHandler(files);
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
     // check for errors
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
     {
         std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
         return;
     }
-    // retrieve directory path
-    directory = path.substr(0, path.find_last_of('/'));
 
     // process children node recursively from rootNode
     processNode(scene->mRootNode, scene);
+
+    // store the flattened meshes so the next start can skip Assimp, until the model, its materials or textures change
+    std::vector<std::string> dependencies;
+    for (unsigned int i = 0; i < files->opened.size(); i++)
+        if (files->opened[i] != path)
+            dependencies.push_back(files->opened[i]);
+    for (unsigned int i = 0; i < textures_loaded.size(); i++)
+        dependencies.push_back(directory + '/' + textures_loaded[i].path);
+    std::sort(dependencies.begin(), dependencies.end());
+    dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+    MeshCache::Save(path, MODEL_IMPORT_FLAGS, processingFlags(), dependencies, meshes);
+}
+
+// build meshes from mesh cache data without touching Assimp
+void Model::processCachedMeshes(std::vector<CachedMesh>& cached)
+{
+    for (unsigned int i = 0; i < cached.size(); i++)
+    {
+        std::vector<Texture> textures;
+        for (unsigned int j = 0; j < cached[i].textures.size(); j++)
+            textures.push_back(loadTexture(cached[i].textures[j].path.c_str(), cached[i].textures[j].type));
+
+        meshes.push_back(Mesh(std::move(cached[i].vertices), std::move(cached[i].indices), textures, options.vertexFormat,
+            std::move(cached[i].lods), std::move(cached[i].meshlets)));
+    }
 }
 
 // recursively process all nodes in scene
@@ -40,7 +290,7 @@ void Model::processNode(aiNode* node, const aiScene* scene)
     {
         // nodes only contain indices. scene contains all the vertices coords
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene)); // add processed mesh to mesh vector
+        processMesh(mesh, scene); // adds the processed mesh to the mesh vector
     }
     // after processing every mesh, go to children nodes
     for (unsigned int i = 0; i < node->mNumChildren; i++)
@@ -50,8 +300,8 @@ void Model::processNode(aiNode* node, const aiScene* scene)
 
 }
 
-// process Assimp mesh data to our Mesh object
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+// process Assimp mesh data to our Mesh object(s)
+void Model::processMesh(aiMesh* mesh, const aiScene* scene)
 {
     // data to fill
     std::vector<Vertex> vertices;
@@ -116,8 +366,112 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     }
     
-    // return a mesh object created from the extracted mesh data
-    return Mesh(vertices, indices, textures);
+    // split meshes too large for 16-bit indices into parts sharing the same textures
+    std::vector<MeshPart> parts;
+    if (options.splitFor16BitIndices && vertices.size() > MAX_16BIT_VERTICES)
+        parts = SplitMesh(vertices, indices);
+    else
+        parts.push_back(MeshPart{ std::move(vertices), std::move(indices) });
+
+    // add a mesh object created from the extracted mesh data
+    for (unsigned int i = 0; i < parts.size(); i++)
+    {
+        if (options.optimizeVertexCache)
+            optimizeMesh(parts[i].vertices, parts[i].indices, static_cast<unsigned int>(meshes.size()));
+        std::vector<MeshLod> lods;
+        if (options.generateLods)
+            lods = generateLods(parts[i].vertices, parts[i].indices, static_cast<unsigned int>(meshes.size()));
+        std::vector<Meshlet> meshlets;
+        if (options.buildMeshlets)
+            meshlets = buildMeshlets(parts[i].vertices, parts[i].indices, static_cast<unsigned int>(meshes.size()));
+        meshes.push_back(Mesh(std::move(parts[i].vertices), std::move(parts[i].indices), textures, options.vertexFormat,
+            std::move(lods), std::move(meshlets)));
+    }
+}
+
+// runs the vertex cache / overdraw / vertex fetch optimizations on one mesh and prints its ACMR and ATVR
+void Model::optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, unsigned int meshIndex) const
+{
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+    std::vector<unsigned int> clusters;
+    indices = OptimizeVertexCache(indices, vertices.size(), VERTEX_CACHE_SIZE, &clusters);
+    if (options.optimizeOverdraw)
+        indices = OptimizeOverdraw(indices, vertices, clusters);
+    OptimizeVertexFetch(vertices, indices);
+
+    VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "MODEL::OPTIMIZE mesh %u (%zu triangles, %zu clusters): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+        meshIndex, indices.size() / 3, clusters.size(), before.acmr, after.acmr, before.atvr, after.atvr);
+    std::cout << line << std::endl;
+}
+
+// simplifies one mesh into its levels of detail and prints their triangle counts and errors
+std::vector<MeshLod> Model::generateLods(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices, unsigned int meshIndex) const
+{
+    std::vector<MeshLod> lods = GenerateLods(vertices, indices);
+
+    // the coarser levels get the same triangle order treatment as the full mesh, the vertices are shared
+    if (options.optimizeVertexCache)
+        for (MeshLod& lod : lods)
+            lod.indices = OptimizeVertexCache(lod.indices, vertices.size(), VERTEX_CACHE_SIZE);
+
+    std::string line = "MODEL::LOD mesh " + std::to_string(meshIndex) + ": " + std::to_string(indices.size() / 3) + " triangles";
+    for (MeshLod const& lod : lods)
+    {
+        char level[96];
+        std::snprintf(level, sizeof(level), " -> %zu (error %.2e)", lod.indices.size() / 3, lod.error);
+        line += level;
+    }
+    std::cout << line << std::endl;
+    return lods;
+}
+
+// splits one mesh into meshlets and prints their sizes and the vertex cache cost of the reordering
+std::vector<Meshlet> Model::buildMeshlets(std::vector<Vertex> const& vertices, std::vector<unsigned int>& indices, unsigned int meshIndex) const
+{
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+    std::vector<Meshlet> meshlets = BuildMeshlets(vertices, indices);
+    VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+
+    size_t vertexCount = 0;
+    unsigned int cullable = 0;
+    for (Meshlet const& meshlet : meshlets)
+    {
+        vertexCount += meshlet.vertexCount;
+        cullable += meshlet.coneCutoff <= 1.0f;
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line), "MODEL::MESHLETS mesh %u: %zu meshlets, %.1f vertices and %.1f triangles on average, %u with a usable normal cone, ACMR %.3f -> %.3f",
+        meshIndex, meshlets.size(), meshlets.empty() ? 0.0 : double(vertexCount) / meshlets.size(),
+        meshlets.empty() ? 0.0 : double(indices.size() / 3) / meshlets.size(), cullable, before.acmr, after.acmr);
+    std::cout << line << std::endl;
+    return meshlets;
+}
+
+// level of detail mesh i draws with
+unsigned int Model::lodOf(unsigned int i) const
+{
+    return i < selectedLods.size() ? selectedLods[i] : 0;
+}
+
+// ModelProcessing bits of the current options
+unsigned int Model::processingFlags() const
+{
+    unsigned int flags = 0;
+    if (options.splitFor16BitIndices)
+        flags |= MODEL_PROCESS_SPLIT_16BIT;
+    if (options.optimizeVertexCache)
+        flags |= MODEL_PROCESS_VERTEX_CACHE;
+    if (options.optimizeVertexCache && options.optimizeOverdraw)
+        flags |= MODEL_PROCESS_OVERDRAW;
+    if (options.generateLods)
+        flags |= MODEL_PROCESS_LODS;
+    if (options.buildMeshlets)
+        flags |= MODEL_PROCESS_MESHLETS;
+    return flags;
 }
 
 // load material textures
@@ -128,67 +482,94 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
     {
         aiString str;
         mat->GetTexture(type, i, &str); // retrives path to texture
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
-        }
-        if (!skip)
-        {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), directory); // load texture with stbi_image
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);
-        }
-        
+        textures.push_back(loadTexture(str.C_Str(), typeName));
     }
     return textures;
 }
 
-// loads texture using stbi_image
-unsigned int Model::TextureFromFile(const char* path, const std::string& directory)
+// load a single texture, reusing it if any model already loaded it
+Texture Model::loadTexture(const char* path, std::string const& typeName)
+{
+    Texture texture;
+    // color maps are filtered in linear space, data maps as they are
+    MipmapMode mipmapMode = MIPMAP_LINEAR;
+    if (typeName == "texture_diffuse")
+        mipmapMode = MIPMAP_SRGB;
+    else if (typeName == "texture_normal")
+        mipmapMode = MIPMAP_NORMALS;
+    texture.id = TextureFromFile(path, directory, mipmapMode); // load texture with stbi_image
+    texture.type = typeName;
+    texture.path = path;
+    textures_loaded.push_back(texture);
+    return texture;
+}
+
+// loads texture using stbi_image unless the TextureRegistry already has it
+unsigned int Model::TextureFromFile(const char* path, const std::string& directory, MipmapMode mipmapMode)
 {
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
     unsigned int textureID;
-    glGenTextures(1, &textureID);
+    TextureParams params;
+    params.mipmapMode = mipmapMode;
+    params.compress = options.compressTextures;
+    if (TextureRegistry::Acquire(filename, params, textureID))
+        return textureID;
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // decode on a worker, the upload happens in finishTextureUploads
+    if (options.decodePool)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+        pendingTextures.emplace_back(textureID, options.decodePool->Enqueue([filename, params]() { return DecodeTexture(filename, params); }));
+        return textureID;
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    TextureImage image = DecodeTexture(filename, params);
+    if (options.textureStreamer)
+        options.textureStreamer->Queue(textureID, image);
+    else
+        TextureRegistry::SetMemory(textureID, UploadTexture(textureID, image));
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
 
-        stbi_image_free(data);
+// waits for the queued decode jobs and uploads their pixels, or leaves both to the texture streamer
+void Model::finishTextureUploads()
+{
+    for (unsigned int i = 0; i < pendingTextures.size(); i++)
+    {
+        if (options.textureStreamer)
+        {
+            options.textureStreamer->Queue(pendingTextures[i].first, std::move(pendingTextures[i].second));
+            continue;
+        }
+        TextureImage image = pendingTextures[i].second.get();
+        TextureRegistry::SetMemory(pendingTextures[i].first, UploadTexture(pendingTextures[i].first, image));
     }
-    else
+    pendingTextures.clear();
+}
+
+// prints the vertex memory saved by VERTEX_FORMAT_PACKED and checks the decode error
+void Model::reportVertexCompression(std::string const& path)
+{
+    size_t fullBytes = 0;
+    size_t packedBytes = 0;
+    VertexCompressionError worst = { 0.0f, 0.0f, 0.0f, true };
+    for (unsigned int i = 0; i < meshes.size(); i++)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        fullBytes += meshes[i].vertices.size() * sizeof(Vertex);
+        packedBytes += meshes[i].vertexBufferSize;
+
+        VertexCompressionError error = MeasureCompressionError(meshes[i].vertices);
+        worst.position = std::max(worst.position, error.position);
+        worst.normal = std::max(worst.normal, error.normal);
+        worst.texCoords = std::max(worst.texCoords, error.texCoords);
+        worst.withinBounds = worst.withinBounds && error.withinBounds;
     }
 
-    return textureID;
-}
\ No newline at end of file
+    char line[512];
+    std::snprintf(line, sizeof(line), "MODEL::VERTEX_COMPRESSION %s: %.1f KB -> %.1f KB (saved %.1f KB), max error position %.2e normal %.2e uv %.2e %s",
+        path.c_str(), fullBytes / 1024.0, packedBytes / 1024.0, (fullBytes - packedBytes) / 1024.0,
+        worst.position, worst.normal, worst.texCoords, worst.withinBounds ? "[within bounds]" : "[ERROR: exceeds bounds]");
+    std::cout << line << std::endl;
+}
@@ -9,10 +9,30 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/DefaultIOSystem.h>
 
+#include "bounds.h"
+#include "frustumculler.h"
+#include "geometryarena.h"
+#include "indirectrenderer.h"
 #include "mesh.h"
+#include "meshcache.h"
+#include "meshletculler.h"
+#include "meshprocessing.h"
+#include "occlusionculler.h"
+#include "profiler.h"
+#include "renderqueue.h"
+#include "scenebvh.h"
 #include "shader.h"
+#include "textureloader.h"
+#include "textureregistry.h"
+#include "texturestreamer.h"
+#include "threadpool.h"
+#include "vertexcompression.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <future>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -20,21 +40,121 @@
 #include <map>
 #include <vector>
 
+// Assimp post-process steps run on import, part of the mesh cache key
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// how a Model is loaded
+struct ModelOptions {
+    // decode textures on this pool's worker threads while the meshes are built
+    ThreadPool* decodePool = nullptr;
+    // upload textures through this streamer over the following frames instead of before the constructor returns
+    TextureStreamer* textureStreamer = nullptr;
+    // GPU vertex layout of every mesh
+    VertexFormat vertexFormat = VERTEX_FORMAT_FULL;
+    // split meshes with more than 65536 vertices so every mesh can use 16-bit indices
+    bool splitFor16BitIndices = false;
+    // reorder triangles for the post-transform vertex cache and vertices for fetch locality
+    bool optimizeVertexCache = false;
+    // additionally reorder triangle clusters front to back to reduce overdraw (needs optimizeVertexCache)
+    bool optimizeOverdraw = false;
+    // simplify every mesh into up to MAX_MESH_LODS - 1 coarser levels of detail, picked at runtime by SelectLods
+    bool generateLods = false;
+    // split every mesh into meshlets with bounds and normal cones for per-cluster culling, see DrawMeshlets
+    bool buildMeshlets = false;
+    // block compress textures with their mip chains, cached as DDS files next to the images (see texturecompression.h)
+    bool compressTextures = false;
+};
+
+// import-time processing steps enabled by ModelOptions, part of the mesh cache key
+enum ModelProcessing {
+    MODEL_PROCESS_SPLIT_16BIT = 1 << 0,
+    MODEL_PROCESS_VERTEX_CACHE = 1 << 1,
+    MODEL_PROCESS_OVERDRAW = 1 << 2,
+    MODEL_PROCESS_LODS = 1 << 3,
+    MODEL_PROCESS_MESHLETS = 1 << 4
+};
 
 class Model
 {
 public:
-    // constructor
-    Model(std::string const& path);
+    // constructor. With a decodePool, textures are decoded on its worker threads while the
+    // meshes are built and only uploaded on the calling (GL) thread at the end, or with a textureStreamer
+    // handed to it still decoding
+    Model(std::string const& path, ModelOptions const& options = ModelOptions());
+
+    // releases this model's references on the shared textures, its geometry in the arena and the instance buffer
+    ~Model();
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // draw every mesh in model at the level of detail picked by the last SelectLods. With a culler only the meshes
+    // whose boxes, added by AddBounds at index first, passed the last FrustumCuller::Cull. Returns the triangles drawn
+    size_t Draw(Shader& shader, FrustumCuller const* culler = nullptr, size_t first = 0);
+
+    // draw count instances of the model, one per model matrix, with a single instanced draw per mesh. Instances
+    // always use the full meshes. Returns the triangles drawn
+    size_t DrawInstanced(Shader& shader, glm::mat4 const* transforms, size_t count);
+
+    // like Draw, but meshes at full detail that have meshlets only draw the meshlets meshletCuller keeps (between
+    // its Begin and the end of the frame). Returns the triangles drawn
+    size_t DrawMeshlets(Shader& shader, MeshletCuller& meshletCuller, glm::mat4 const& model, FrustumCuller const* culler = nullptr, size_t first = 0);
+
+    // queue every mesh in model for the next IndirectRenderer::Flush, with a culler only the visible ones.
+    // Returns the triangles queued
+    size_t Submit(IndirectRenderer& renderer, glm::mat4 const& model, FrustumCuller const* culler = nullptr, size_t first = 0);
+
+    // queue every mesh in model for the next RenderQueue::Flush, drawn with shader at a view distance of depth.
+    // With a culler only the visible ones. Returns the triangles queued
+    size_t Submit(RenderQueue& queue, Shader& shader, glm::mat4 const& model, float depth, FrustumCuller const* culler = nullptr, size_t first = 0);
+
+    // picks the level of detail of every mesh under model seen from viewPosition: the coarsest one whose
+    // simplification error projects to at most maxPixelError pixels. pixelsPerUnit comes from Camera::PixelsPerUnit
+    void SelectLods(glm::mat4 const& model, glm::vec3 const& viewPosition, float pixelsPerUnit, float maxPixelError);
+
+    // triangles of every mesh at full detail
+    size_t Triangles() const;
+
+    // GPU memory of the textures this model uses, counting textures shared with other models in full.
+    // Textures still streaming in count as zero
+    TextureMemory TextureMemoryUsed() const;
+
+    // model space box around every mesh
+    BoundingBox Bounds() const;
+
+    // adds the world space box of every mesh under model to culler and returns the index of the first one
+    size_t AddBounds(FrustumCuller& culler, glm::mat4 const& model) const;
 
-    // draw every mesh in model
-    void Draw(Shader& shader);
+    // inserts the world space box of every mesh under model into bvh and appends the handles to objects
+    void InsertBounds(SceneBvh& bvh, glm::mat4 const& model, std::vector<unsigned int>& objects) const;
+
+    // moves the objects InsertBounds created to model
+    void UpdateBounds(SceneBvh& bvh, glm::mat4 const& model, std::vector<unsigned int> const& objects) const;
+
+    // rasterizes every mesh under model into the occlusion culler's depth buffer
+    void RasterizeOccluders(OcclusionCuller& occlusion, glm::mat4 const& model) const;
 
 private:
     // mesh data
     std::vector<Mesh> meshes;
     std::string directory;
-    std::vector<Texture> textures_loaded;
+    std::vector<Texture> textures_loaded; // every texture reference this model holds in the TextureRegistry
+
+    ModelOptions options;
+
+    // profiler scope of this model's draws, "Model::Draw <file>"
+    const char* drawScopeName;
+
+    // level of detail of every mesh, set by SelectLods
+    std::vector<unsigned int> selectedLods;
+
+    // per-instance matrices of the last DrawInstanced
+    std::vector<InstanceData> instanceData;
+    unsigned int instanceBuffer;
+    size_t instanceBufferSize;
+
+    // parallel texture decoding
+    std::vector<std::pair<unsigned int, std::future<TextureImage>>> pendingTextures;
 
     // load model into Assimp Scene object
     void loadModel(std::string const& path);
@@ -42,14 +162,41 @@ private:
     // recursively process all nodes in scene
     void processNode(aiNode* node, const aiScene* scene);
 
-    // process Assimp mesh data to our Mesh object
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    // process Assimp mesh data to our Mesh object(s)
+    void processMesh(aiMesh* mesh, const aiScene* scene);
+
+    // runs the vertex cache / overdraw / vertex fetch optimizations on one mesh and prints its ACMR and ATVR
+    void optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, unsigned int meshIndex) const;
+
+    // simplifies one mesh into its levels of detail and prints their triangle counts and errors
+    std::vector<MeshLod> generateLods(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices, unsigned int meshIndex) const;
+
+    // splits one mesh into meshlets and prints their sizes and the vertex cache cost of the reordering
+    std::vector<Meshlet> buildMeshlets(std::vector<Vertex> const& vertices, std::vector<unsigned int>& indices, unsigned int meshIndex) const;
+
+    // level of detail mesh i draws with
+    unsigned int lodOf(unsigned int i) const;
+
+    // ModelProcessing bits of the current options
+    unsigned int processingFlags() const;
+
+    // build meshes from mesh cache data without touching Assimp
+    void processCachedMeshes(std::vector<CachedMesh>& cached);
 
     // load material textures
     std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
 
-    // loads texture using stbi_image
-    unsigned int TextureFromFile(const char* path, const std::string& directory);
+    // load a single texture, reusing it if any model already loaded it
+    Texture loadTexture(const char* path, std::string const& typeName);
+
+    // loads texture using stbi_image unless the TextureRegistry already has it, building its mip chain in mipmapMode
+    unsigned int TextureFromFile(const char* path, const std::string& directory, MipmapMode mipmapMode);
+
+    // waits for the queued decode jobs and uploads their pixels, or leaves both to the texture streamer
+    void finishTextureUploads();
+
+    // prints the vertex memory saved by VERTEX_FORMAT_PACKED and checks the decode error
+    void reportVertexCompression(std::string const& path);
 };
 
 #endif
\ No newline at end of file
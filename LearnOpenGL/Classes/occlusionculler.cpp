@@ -0,0 +1,229 @@
+#include "occlusionculler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    // pyramid level whose texels a box rectangle is compared against covers at most this many texels per side
+    const int MAX_TEST_TEXELS = 4;
+
+    // position i of a strided array
+    glm::vec3 const& positionAt(const glm::vec3* first, size_t i, size_t stride)
+    {
+        return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const unsigned char*>(first) + i * stride);
+    }
+
+    // signed distance of a clip space point to the near plane (z = -w), positive in front of it
+    float nearDistance(glm::vec4 const& clip)
+    {
+        return clip.z + clip.w;
+    }
+}
+
+// constructor
+OcclusionCuller::OcclusionCuller(int width, int height)
+{
+    Stats = OcclusionStats{ 0, 0, 0 };
+    this->width = std::max(width, 1);
+    this->height = std::max(height, 1);
+    viewProjection = glm::mat4(1.0f);
+
+    // level sizes round up, so the last row / column of a level may only cover one texel of the one below
+    int levelWidth = this->width;
+    int levelHeight = this->height;
+    while (true)
+    {
+        levels.push_back(std::vector<float>(size_t(levelWidth) * levelHeight, 1.0f));
+        levelWidths.push_back(levelWidth);
+        levelHeights.push_back(levelHeight);
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+}
+
+// clears the depth buffer for a new frame
+void OcclusionCuller::Begin(glm::mat4 const& viewProjection)
+{
+    this->viewProjection = viewProjection;
+    std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+    Stats = OcclusionStats{ 0, 0, 0 };
+}
+
+// rasterizes indexCount / 3 triangles
+void OcclusionCuller::RasterizeOccluder(const glm::vec3* positions, size_t stride, const unsigned int* indices, size_t indexCount, glm::mat4 const& model)
+{
+    glm::mat4 transform = viewProjection * model;
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        glm::vec4 clip[3];
+        for (int corner = 0; corner < 3; corner++)
+            clip[corner] = transform * glm::vec4(positionAt(positions, indices[i + corner], stride), 1.0f);
+        Stats.occluderTriangles++;
+
+        // clip against the near plane, the other planes are handled by the scissor in rasterizeTriangle.
+        // One plane turns a triangle into at most a quad
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            glm::vec4 const& current = clip[corner];
+            glm::vec4 const& next = clip[(corner + 1) % 3];
+            float currentDistance = nearDistance(current);
+            float nextDistance = nearDistance(next);
+            if (currentDistance >= 0.0f)
+                polygon[count++] = current;
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+                polygon[count++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+        }
+        if (count < 3)
+            continue;
+
+        glm::vec3 first = toScreen(polygon[0]);
+        glm::vec3 previous = toScreen(polygon[1]);
+        for (int corner = 2; corner < count; corner++)
+        {
+            glm::vec3 current = toScreen(polygon[corner]);
+            rasterizeTriangle(first, previous, current);
+            previous = current;
+        }
+    }
+}
+
+// builds the depth pyramid
+void OcclusionCuller::Finish()
+{
+    for (size_t level = 1; level < levels.size(); level++)
+    {
+        std::vector<float> const& below = levels[level - 1];
+        std::vector<float>& above = levels[level];
+        int belowWidth = levelWidths[level - 1];
+        int belowHeight = levelHeights[level - 1];
+        for (int y = 0; y < levelHeights[level]; y++)
+        {
+            int y0 = 2 * y;
+            int y1 = std::min(2 * y + 1, belowHeight - 1);
+            for (int x = 0; x < levelWidths[level]; x++)
+            {
+                int x0 = 2 * x;
+                int x1 = std::min(2 * x + 1, belowWidth - 1);
+                above[size_t(y) * levelWidths[level] + x] = std::max(
+                    std::max(below[size_t(y0) * belowWidth + x0], below[size_t(y0) * belowWidth + x1]),
+                    std::max(below[size_t(y1) * belowWidth + x0], below[size_t(y1) * belowWidth + x1]));
+            }
+        }
+    }
+}
+
+// false if the world space box is hidden behind the occluders
+bool OcclusionCuller::Visible(BoundingBox const& box)
+{
+    Stats.tested++;
+
+    // screen rectangle and nearest depth of the 8 corners
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float nearest = 1.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 position((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+        glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        if (nearDistance(clip) <= 0.0f || clip.w <= 0.0f)
+            return true;
+        glm::vec3 screen = toScreen(clip);
+        screenMin = glm::min(screenMin, glm::vec2(screen));
+        screenMax = glm::max(screenMax, glm::vec2(screen));
+        nearest = std::min(nearest, screen.z);
+    }
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= width || screenMin.y >= height)
+        return true;
+
+    // every on-screen pixel the rectangle touches, then the level where that is at most MAX_TEST_TEXELS texels wide
+    int x0 = static_cast<int>(std::max(screenMin.x, 0.0f)), y0 = static_cast<int>(std::max(screenMin.y, 0.0f));
+    int x1 = static_cast<int>(std::min(screenMax.x, width - 1.0f)), y1 = static_cast<int>(std::min(screenMax.y, height - 1.0f));
+    size_t level = 0;
+    while (level + 1 < levels.size() && std::max((x1 >> level) - (x0 >> level), (y1 >> level) - (y0 >> level)) + 1 > MAX_TEST_TEXELS)
+        level++;
+
+    int levelWidth = levelWidths[level];
+    std::vector<float> const& depth = levels[level];
+    for (int y = y0 >> level; y <= (y1 >> level); y++)
+        for (int x = x0 >> level; x <= (x1 >> level); x++)
+            if (nearest <= depth[size_t(y) * levelWidth + x])
+                return true;
+
+    Stats.occluded++;
+    return false;
+}
+
+// hides every box the frustum culler let through that is occluded
+void OcclusionCuller::Cull(FrustumCuller& culler)
+{
+    for (size_t i = 0; i < culler.Size(); i++)
+        if (culler.Visible(i) && !Visible(culler.Box(i)))
+            culler.Hide(i);
+}
+
+// depth buffer of the current frame
+const float* OcclusionCuller::DepthBuffer() const
+{
+    return levels[0].data();
+}
+
+int OcclusionCuller::Width() const
+{
+    return width;
+}
+
+int OcclusionCuller::Height() const
+{
+    return height;
+}
+
+// scan converts one triangle with edge functions evaluated at pixel centers, keeping the nearest depth
+void OcclusionCuller::rasterizeTriangle(glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c)
+{
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area == 0.0f)
+        return;
+
+    // both windings are drawn, occluders are solid from either side
+    float inverseArea = 1.0f / area;
+    // clamped as floats, vertices close to the near plane can land far outside the int range
+    int minX = static_cast<int>(std::max(std::min({ a.x, b.x, c.x }), 0.0f));
+    int minY = static_cast<int>(std::max(std::min({ a.y, b.y, c.y }), 0.0f));
+    int maxX = static_cast<int>(std::min(std::max({ a.x, b.x, c.x }), width - 1.0f));
+    int maxY = static_cast<int>(std::min(std::max({ a.y, b.y, c.y }), height - 1.0f));
+
+    std::vector<float>& depth = levels[0];
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        for (int x = minX; x <= maxX; x++)
+        {
+            float px = x + 0.5f;
+
+            // barycentric weights, all non-negative inside whatever the winding
+            float weightA = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) * inverseArea;
+            float weightB = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) * inverseArea;
+            float weightC = 1.0f - weightA - weightB;
+            if (weightA < 0.0f || weightB < 0.0f || weightC < 0.0f)
+                continue;
+
+            // depth after the perspective divide is affine in screen space
+            float z = weightA * a.z + weightB * b.z + weightC * c.z;
+            float& stored = depth[size_t(y) * width + x];
+            if (z >= 0.0f && z < stored)
+                stored = z;
+        }
+    }
+}
+
+// clip space to screen pixels and depth
+glm::vec3 OcclusionCuller::toScreen(glm::vec4 const& clip) const
+{
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+}
@@ -0,0 +1,73 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include "bounds.h"
+#include "frustumculler.h"
+
+#include <cstddef>
+#include <vector>
+
+// counters of the last frame
+struct OcclusionStats {
+    unsigned int occluderTriangles;
+    unsigned int tested;
+    unsigned int occluded;
+};
+
+// Software occlusion culling on the CPU. A few large occluders are rasterized into a small depth buffer, a
+// max-depth pyramid (hierarchical Z) is built over it, and every box is compared against the pyramid level where
+// its screen rectangle covers a handful of texels: a box is occluded if its nearest point lies behind the
+// farthest occluder depth in all of them. Occluders are sampled at pixel centers, so at the low resolution
+// they should be meshes that fill their silhouette (walls, large props); boxes crossing the near plane or
+// entirely off screen always count as visible. Everything is plain float math, so the same scene gives the same
+// depth buffer and results on every run, with or without an OpenGL context.
+//
+//   occlusion.Begin(projection * view);
+//   model.RasterizeOccluders(occlusion, transform);
+//   occlusion.Finish();
+//   occlusion.Cull(culler);  // hides the visible boxes of a FrustumCuller that are occluded
+class OcclusionCuller
+{
+public:
+    // counters of the last frame
+    OcclusionStats Stats;
+
+    // constructor, width x height is the depth buffer resolution
+    OcclusionCuller(int width = 256, int height = 144);
+
+    // clears the depth buffer for a new frame seen through viewProjection
+    void Begin(glm::mat4 const& viewProjection);
+
+    // rasterizes indexCount / 3 triangles, positions read with the given byte stride and placed by model
+    void RasterizeOccluder(const glm::vec3* positions, size_t stride, const unsigned int* indices, size_t indexCount, glm::mat4 const& model);
+
+    // builds the depth pyramid, call after the last occluder
+    void Finish();
+
+    // false if the world space box is hidden behind the occluders
+    bool Visible(BoundingBox const& box);
+
+    // hides every box the frustum culler let through that is occluded
+    void Cull(FrustumCuller& culler);
+
+    // depth buffer (0 near, 1 far, rows bottom up) of the current frame, e.g. to compare runs
+    const float* DepthBuffer() const;
+    int Width() const;
+    int Height() const;
+
+private:
+    int width, height;
+    glm::mat4 viewProjection;
+
+    // level 0 is the depth buffer, every further level holds the max of 2x2 texels of the one below
+    std::vector<std::vector<float>> levels;
+    std::vector<int> levelWidths, levelHeights;
+
+    // scan converts one triangle given in screen pixels (xy) and depth (z)
+    void rasterizeTriangle(glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c);
+
+    // clip space to screen pixels and depth
+    glm::vec3 toScreen(glm::vec4 const& clip) const;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "offscreentarget.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// creates the framebuffer
+OffscreenTarget::OffscreenTarget(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::OFFSCREEN::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// deletes the framebuffer and its renderbuffers
+OffscreenTarget::~OffscreenTarget()
+{
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+// binds the framebuffer and sets the viewport to cover it
+void OffscreenTarget::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+// the color buffer as RGB rows, top row first
+std::vector<unsigned char> OffscreenTarget::ReadPixels() const
+{
+    std::vector<unsigned char> pixels(size_t(width) * height * 3);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    // GL returns the bottom row first
+    size_t rowSize = size_t(width) * 3;
+    std::vector<unsigned char> row(rowSize);
+    for (int y = 0; y < height / 2; y++)
+    {
+        unsigned char* top = &pixels[y * rowSize];
+        unsigned char* bottom = &pixels[(height - 1 - y) * rowSize];
+        std::memcpy(row.data(), top, rowSize);
+        std::memcpy(top, bottom, rowSize);
+        std::memcpy(bottom, row.data(), rowSize);
+    }
+    return pixels;
+}
+
+// writes the color buffer to a binary PPM file
+bool OffscreenTarget::WritePPM(std::string const& path) const
+{
+    std::vector<unsigned char> pixels = ReadPixels();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cout << "ERROR::OFFSCREEN::FILE_NOT_WRITABLE " << path << std::endl;
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    return static_cast<bool>(out);
+}
+
+int OffscreenTarget::Width() const
+{
+    return width;
+}
+
+int OffscreenTarget::Height() const
+{
+    return height;
+}
@@ -0,0 +1,41 @@
+#ifndef OFFSCREENTARGET_H
+#define OFFSCREENTARGET_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// A framebuffer object with an RGBA8 color and a 24-bit depth renderbuffer that stands in for the default
+// framebuffer where there is none, e.g. with a HeadlessContext. The rendered frame can be read back and saved.
+class OffscreenTarget
+{
+public:
+    // creates the framebuffer, prints an error if it is incomplete
+    OffscreenTarget(int width, int height);
+
+    // deletes the framebuffer and its renderbuffers
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    // binds the framebuffer for drawing and reading and sets the viewport to cover it
+    void Bind();
+
+    // the color buffer as tightly packed RGB rows, top row first
+    std::vector<unsigned char> ReadPixels() const;
+
+    // writes the color buffer to a binary PPM (P6) file
+    bool WritePPM(std::string const& path) const;
+
+    int Width() const;
+    int Height() const;
+
+private:
+    unsigned int framebuffer;
+    unsigned int colorBuffer, depthBuffer;
+    int width, height;
+};
+
+#endif
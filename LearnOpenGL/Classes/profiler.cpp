@@ -0,0 +1,520 @@
+#include "profiler.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace
+{
+    // events a thread can record between two EndFrame calls before the oldest are overwritten
+    const uint64_t RING_CAPACITY = 1 << 14;
+    // nesting deeper than this is not recorded
+    const unsigned int MAX_DEPTH = 64;
+    // frames kept for the graphs
+    const size_t HISTORY_FRAMES = 240;
+    // events kept for the trace, about 64 MB
+    const size_t MAX_TRACE_EVENTS = 1 << 21;
+
+    // Closed scopes of one thread. Only the owning thread writes events and advances head, only the GL thread
+    // advances tail, so the pair is a single producer single consumer queue
+    struct ThreadRing {
+        std::vector<ProfileEvent> events;
+        std::atomic<uint64_t> head;
+        uint64_t tail;
+
+        // scopes open on the thread
+        const char* openNames[MAX_DEPTH];
+        double openStarts[MAX_DEPTH];
+        unsigned int depth;
+
+        unsigned int index;
+        std::atomic<const char*> name;
+    };
+
+    // GPU scope waiting for its queries
+    struct GpuScope {
+        const char* name;
+        unsigned int depth;
+        GLuint startQuery;
+        GLuint endQuery;
+    };
+
+    // query pool and scopes of one frame in flight
+    struct GpuFrame {
+        std::vector<GLuint> queries;
+        size_t usedQueries = 0;
+        std::vector<GpuScope> scopes;
+        uint64_t frame = 0;
+        bool pending = false;
+        // CPU and GPU clock read at the same moment, maps the query results onto the CPU timeline
+        double cpuBase = 0.0;
+        GLint64 gpuBase = 0;
+    };
+
+    std::atomic<bool> recording(false);
+
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    thread_local ThreadRing* threadRing = nullptr;
+
+    std::mutex namesMutex;
+    std::unordered_set<std::string> names;
+
+    // GL thread state
+    GpuFrame gpuFrames[PROFILE_GPU_LATENCY];
+    uint64_t frameIndex = 0;
+    bool frameOpen = false;
+    double frameStart = 0.0;
+    // indices into the current frame's scopes, SIZE_MAX for scopes begun outside a frame
+    std::vector<size_t> openGpuScopes;
+    std::vector<ProfileEvent> gpuEvents;
+
+    std::vector<ProfileEvent> lastFrame;
+    std::vector<ProfileFrame> history;
+    std::vector<uint64_t> historyFrames;
+    std::vector<ProfileEvent> trace;
+    uint64_t droppedEvents = 0;
+    unsigned int droppedGpuFrames = 0;
+
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    // microseconds since the program started
+    double nowUs()
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // the calling thread's ring, registered on its first scope
+    ThreadRing& ringOfThread()
+    {
+        if (!threadRing)
+        {
+            std::unique_ptr<ThreadRing> ring(new ThreadRing());
+            ring->events.resize(RING_CAPACITY);
+            ring->head = 0;
+            ring->tail = 0;
+            ring->depth = 0;
+            ring->name = nullptr;
+
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            ring->index = static_cast<unsigned int>(rings.size());
+            threadRing = ring.get();
+            rings.push_back(std::move(ring));
+        }
+        return *threadRing;
+    }
+
+    // display name of a thread index
+    std::string threadName(unsigned int thread)
+    {
+        if (thread == PROFILE_GPU_THREAD)
+            return "GPU";
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        const char* name = thread < rings.size() ? rings[thread]->name.load() : nullptr;
+        return name ? std::string(name) : "Thread " + std::to_string(thread);
+    }
+
+    // appends an event to the trace while it has room
+    void addToTrace(ProfileEvent const& event)
+    {
+        if (trace.size() < MAX_TRACE_EVENTS)
+            trace.push_back(event);
+        else
+            droppedEvents++;
+    }
+
+    // next unused query of a frame's pool
+    GLuint nextQuery(GpuFrame& frame)
+    {
+        if (frame.usedQueries == frame.queries.size())
+        {
+            size_t grown = std::max<size_t>(32, frame.queries.size() * 2);
+            size_t first = frame.queries.size();
+            frame.queries.resize(grown);
+            glGenQueries(static_cast<GLsizei>(grown - first), &frame.queries[first]);
+        }
+        return frame.queries[frame.usedQueries++];
+    }
+
+    // reads back the queries of a frame recorded PROFILE_GPU_LATENCY frames ago, unless the GPU is still behind
+    void resolve(GpuFrame& frame)
+    {
+        frame.pending = false;
+        if (frame.scopes.empty())
+            return;
+
+        GLint available = 0;
+        glGetQueryObjectiv(frame.scopes.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            droppedGpuFrames++;
+            return;
+        }
+
+        gpuEvents.clear();
+        double total = 0.0;
+        for (GpuScope const& scope : frame.scopes)
+        {
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(scope.startQuery, GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+            ProfileEvent event;
+            event.name = scope.name;
+            event.start = frame.cpuBase + (static_cast<double>(start) - static_cast<double>(frame.gpuBase)) / 1000.0;
+            event.duration = (static_cast<double>(end) - static_cast<double>(start)) / 1000.0;
+            event.depth = scope.depth;
+            event.thread = PROFILE_GPU_THREAD;
+            gpuEvents.push_back(event);
+            addToTrace(event);
+            if (scope.depth == 0)
+                total += event.duration;
+        }
+
+        auto found = std::find(historyFrames.begin(), historyFrames.end(), frame.frame);
+        if (found != historyFrames.end())
+            history[found - historyFrames.begin()].gpuMs = total / 1000.0;
+    }
+
+    // JSON string contents
+    std::string escape(const char* text)
+    {
+        std::string escaped;
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(*c) >= 0x20)
+                escaped += *c;
+        }
+        return escaped;
+    }
+}
+
+// starts or stops recording
+void Profiler::SetEnabled(bool enabled)
+{
+    recording.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::Enabled()
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+// frame boundaries, called by the GL thread around everything a frame renders
+void Profiler::BeginFrame()
+{
+    if (!Enabled())
+        return;
+
+    // the slot's previous frame was recorded PROFILE_GPU_LATENCY frames ago
+    GpuFrame& gpuFrame = gpuFrames[frameIndex % PROFILE_GPU_LATENCY];
+    if (gpuFrame.pending)
+        resolve(gpuFrame);
+    gpuFrame.usedQueries = 0;
+    gpuFrame.scopes.clear();
+    gpuFrame.frame = frameIndex;
+    glGetInteger64v(GL_TIMESTAMP, &gpuFrame.gpuBase);
+    gpuFrame.cpuBase = nowUs();
+    openGpuScopes.clear();
+
+    frameOpen = true;
+    frameStart = gpuFrame.cpuBase;
+    BeginCpu("Frame");
+}
+
+void Profiler::EndFrame()
+{
+    // stopped recording keeps the last frame on screen
+    if (!frameOpen && !Enabled())
+        return;
+    lastFrame.clear();
+
+    double frameMs = 0.0;
+    bool finished = frameOpen;
+    if (frameOpen)
+    {
+        EndCpu();
+        frameOpen = false;
+        frameMs = (nowUs() - frameStart) / 1000.0;
+        gpuFrames[frameIndex % PROFILE_GPU_LATENCY].pending = true;
+    }
+
+    // drain every thread's ring
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (std::unique_ptr<ThreadRing> const& ring : rings)
+        {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            if (head - ring->tail > RING_CAPACITY)
+            {
+                droppedEvents += head - ring->tail - RING_CAPACITY;
+                ring->tail = head - RING_CAPACITY;
+            }
+            for (; ring->tail < head; ring->tail++)
+            {
+                lastFrame.push_back(ring->events[ring->tail & (RING_CAPACITY - 1)]);
+                addToTrace(lastFrame.back());
+            }
+        }
+    }
+    lastFrame.insert(lastFrame.end(), gpuEvents.begin(), gpuEvents.end());
+
+    // by thread, parents before their children
+    std::sort(lastFrame.begin(), lastFrame.end(), [](ProfileEvent const& a, ProfileEvent const& b)
+    {
+        if (a.thread != b.thread)
+            return a.thread < b.thread;
+        if (a.start != b.start)
+            return a.start < b.start;
+        return a.depth < b.depth;
+    });
+
+    if (finished)
+    {
+        history.push_back(ProfileFrame{ frameMs, 0.0, static_cast<unsigned int>(lastFrame.size()) });
+        historyFrames.push_back(frameIndex);
+        if (history.size() > HISTORY_FRAMES)
+        {
+            history.erase(history.begin());
+            historyFrames.erase(historyFrames.begin());
+        }
+        frameIndex++;
+    }
+}
+
+// scope markers. These record even when disabled, the RAII scopes check Enabled
+void Profiler::BeginCpu(const char* name)
+{
+    ThreadRing& ring = ringOfThread();
+    if (ring.depth < MAX_DEPTH)
+    {
+        ring.openNames[ring.depth] = name;
+        ring.openStarts[ring.depth] = nowUs();
+    }
+    ring.depth++;
+}
+
+void Profiler::EndCpu()
+{
+    ThreadRing& ring = ringOfThread();
+    if (ring.depth == 0)
+        return;
+    ring.depth--;
+    if (ring.depth >= MAX_DEPTH)
+        return;
+
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ProfileEvent& event = ring.events[head & (RING_CAPACITY - 1)];
+    event.name = ring.openNames[ring.depth];
+    event.start = ring.openStarts[ring.depth];
+    event.duration = nowUs() - event.start;
+    event.depth = ring.depth;
+    event.thread = ring.index;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::BeginGpu(const char* name)
+{
+    // scopes outside a frame (model loading) have no query pool to use
+    if (!frameOpen)
+    {
+        openGpuScopes.push_back(SIZE_MAX);
+        return;
+    }
+
+    GpuFrame& gpuFrame = gpuFrames[frameIndex % PROFILE_GPU_LATENCY];
+    GpuScope scope;
+    scope.name = name;
+    scope.depth = 0;
+    for (size_t open : openGpuScopes)
+        if (open != SIZE_MAX)
+            scope.depth++;
+    scope.startQuery = nextQuery(gpuFrame);
+    scope.endQuery = 0;
+    glQueryCounter(scope.startQuery, GL_TIMESTAMP);
+    openGpuScopes.push_back(gpuFrame.scopes.size());
+    gpuFrame.scopes.push_back(scope);
+}
+
+void Profiler::EndGpu()
+{
+    if (openGpuScopes.empty())
+        return;
+    size_t open = openGpuScopes.back();
+    openGpuScopes.pop_back();
+    if (open == SIZE_MAX || !frameOpen)
+        return;
+
+    GpuFrame& gpuFrame = gpuFrames[frameIndex % PROFILE_GPU_LATENCY];
+    gpuFrame.scopes[open].endQuery = nextQuery(gpuFrame);
+    glQueryCounter(gpuFrame.scopes[open].endQuery, GL_TIMESTAMP);
+}
+
+// a copy of name that stays valid for the lifetime of the program
+const char* Profiler::Intern(std::string const& name)
+{
+    std::lock_guard<std::mutex> lock(namesMutex);
+    return names.insert(name).first->c_str();
+}
+
+// name of the calling thread in the panel and the trace
+void Profiler::SetThreadName(const char* name)
+{
+    ringOfThread().name = Intern(name);
+}
+
+// events of the last finished frame
+std::vector<ProfileEvent> const& Profiler::LastFrame()
+{
+    return lastFrame;
+}
+
+// timings of the recent frames, oldest first
+std::vector<ProfileFrame> const& Profiler::History()
+{
+    return history;
+}
+
+// writes everything recorded since recording started as Chrome trace event JSON
+bool Profiler::WriteChromeTrace(std::string const& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    // the GPU track goes after the last thread
+    size_t threads;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        threads = rings.size();
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t thread = 0; thread <= threads; thread++)
+    {
+        unsigned int index = thread == threads ? PROFILE_GPU_THREAD : static_cast<unsigned int>(thread);
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"name\":\"" << escape(threadName(index).c_str()) << "\"}},\n";
+    }
+
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        ProfileEvent const& event = trace[i];
+        bool gpu = event.thread == PROFILE_GPU_THREAD;
+        file << "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << (gpu ? "gpu" : "cpu")
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (gpu ? threads : event.thread)
+            << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}" << (i + 1 < trace.size() ? ",\n" : "\n");
+    }
+    file << "]}\n";
+
+    std::cout << "PROFILER::TRACE " << path << " (" << trace.size() << " events, " << droppedEvents << " dropped)" << std::endl;
+    return static_cast<bool>(file);
+}
+
+// ImGui window with the frame time graphs, the scope tree of the last frame and a trace export button
+void Profiler::DrawWindow(const char* tracePath)
+{
+    ImGui::Begin("Profiler");
+
+    bool recording = Enabled();
+    if (ImGui::Checkbox("Record", &recording))
+        SetEnabled(recording);
+    ImGui::SameLine();
+    if (ImGui::Button("Write trace"))
+        WriteChromeTrace(tracePath);
+    ImGui::SameLine();
+    ImGui::Text("%zu events in %s, %llu dropped, %u GPU frames not ready", trace.size(), tracePath,
+        static_cast<unsigned long long>(droppedEvents), droppedGpuFrames);
+
+    if (!history.empty())
+    {
+        static std::vector<float> cpuMs, gpuMs;
+        cpuMs.clear();
+        gpuMs.clear();
+        double cpuSum = 0.0, gpuSum = 0.0;
+        unsigned int gpuFrameCount = 0;
+        for (ProfileFrame const& frame : history)
+        {
+            cpuMs.push_back(static_cast<float>(frame.cpuMs));
+            cpuSum += frame.cpuMs;
+            // the newest frames are not resolved yet
+            if (frame.gpuMs > 0.0)
+            {
+                gpuMs.push_back(static_cast<float>(frame.gpuMs));
+                gpuSum += frame.gpuMs;
+                gpuFrameCount++;
+            }
+        }
+        char overlay[64];
+        std::snprintf(overlay, sizeof(overlay), "CPU %.2f ms average", cpuSum / history.size());
+        ImGui::PlotLines("##cpu", cpuMs.data(), static_cast<int>(cpuMs.size()), 0, overlay, 0.0f, FLT_MAX, ImVec2(0, 60));
+        std::snprintf(overlay, sizeof(overlay), "GPU %.2f ms average", gpuFrameCount ? gpuSum / gpuFrameCount : 0.0);
+        ImGui::PlotLines("##gpu", gpuMs.data(), static_cast<int>(gpuMs.size()), 0, overlay, 0.0f, FLT_MAX, ImVec2(0, 60));
+    }
+
+    // scope tree per thread, GPU scopes are from PROFILE_GPU_LATENCY frames ago
+    unsigned int thread = 0;
+    bool open = false;
+    for (size_t i = 0; i < lastFrame.size(); i++)
+    {
+        ProfileEvent const& event = lastFrame[i];
+        if (i == 0 || event.thread != thread)
+        {
+            if (open)
+                ImGui::TreePop();
+            thread = event.thread;
+            std::string header = threadName(thread);
+            open = ImGui::TreeNodeEx(header.c_str(), ImGuiTreeNodeFlags_DefaultOpen);
+        }
+        if (open)
+            ImGui::Text("%*s%-*s %8.3f ms", event.depth * 2, "", 32 - static_cast<int>(event.depth) * 2, event.name, event.duration / 1000.0);
+    }
+    if (open)
+        ImGui::TreePop();
+
+    ImGui::End();
+}
+
+// CPU scope from construction to destruction
+ProfileScope::ProfileScope(const char* name)
+{
+    active = Profiler::Enabled();
+    if (active)
+        Profiler::BeginCpu(name);
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (active)
+        Profiler::EndCpu();
+}
+
+// GPU scope around the GL commands issued from construction to destruction
+GpuProfileScope::GpuProfileScope(const char* name)
+{
+    active = Profiler::Enabled();
+    if (active)
+        Profiler::BeginGpu(name);
+}
+
+GpuProfileScope::~GpuProfileScope()
+{
+    if (active)
+        Profiler::EndGpu();
+}
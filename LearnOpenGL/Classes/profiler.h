@@ -0,0 +1,110 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// thread index of the GPU track in ProfileEvent
+const unsigned int PROFILE_GPU_THREAD = 0xFFFFFFFFu;
+
+// frames between recording GPU scopes and reading their queries back
+const unsigned int PROFILE_GPU_LATENCY = 4;
+
+// one closed scope. Times are microseconds since the program started, GPU times are mapped onto the same clock
+struct ProfileEvent {
+    const char* name; // string literal or Profiler::Intern result
+    double start;
+    double duration;
+    unsigned int depth;
+    unsigned int thread; // registration order of the recording thread, 0 is the first one, or PROFILE_GPU_THREAD
+};
+
+// timings of one finished frame
+struct ProfileFrame {
+    double cpuMs;
+    double gpuMs; // sum of the top level GPU scopes, 0 until the queries of the frame are resolved
+    unsigned int events;
+};
+
+// Frame profiler with nested CPU and GPU scopes, recorded through ProfileScope / GpuProfileScope or the PROFILE_*
+// macros. Every thread writes its closed CPU scopes into its own ring buffer, so recording takes no lock; the GL
+// thread drains all rings in EndFrame. GPU scopes are pairs of GL_TIMESTAMP queries from a pool per frame in
+// flight and are read back PROFILE_GPU_LATENCY frames later, when the results are ready and the read does not
+// stall. Disabled (the default) a scope costs one branch. GPU scopes and the frame calls belong to the GL thread.
+class Profiler
+{
+public:
+    // starts or stops recording. Scopes open while it changes are finished as they were started
+    static void SetEnabled(bool enabled);
+    static bool Enabled();
+
+    // frame boundaries, called by the GL thread around everything a frame renders
+    static void BeginFrame();
+    static void EndFrame();
+
+    // scope markers, prefer the RAII scopes below. name has to stay valid for the lifetime of the program
+    static void BeginCpu(const char* name);
+    static void EndCpu();
+    static void BeginGpu(const char* name);
+    static void EndGpu();
+
+    // a copy of name that stays valid for the lifetime of the program, for names built at runtime
+    static const char* Intern(std::string const& name);
+
+    // name of the calling thread in the panel and the trace
+    static void SetThreadName(const char* name);
+
+    // events of the last finished frame: its CPU scopes and the latest resolved GPU scopes
+    static std::vector<ProfileEvent> const& LastFrame();
+
+    // timings of the recent frames, oldest first
+    static std::vector<ProfileFrame> const& History();
+
+    // writes everything recorded since recording started as Chrome trace event JSON (chrome://tracing, Perfetto)
+    static bool WriteChromeTrace(std::string const& path);
+
+    // ImGui window with the frame time graphs, the scope tree of the last frame and a trace export button
+    static void DrawWindow(const char* tracePath);
+};
+
+// CPU scope from construction to destruction
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool active;
+};
+
+// GPU scope around the GL commands issued from construction to destruction
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(const char* name);
+    ~GpuProfileScope();
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    bool active;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// CPU scope until the end of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+// CPU and GPU scope of the same name until the end of the enclosing block
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name); \
+    GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,155 @@
+#include "renderqueue.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const int PROGRAM_BITS = 8;
+    const int TEXTURE_SET_BITS = 20;
+    const int VAO_BITS = 8;
+    const int DEPTH_BITS = 28;
+
+    const int DEPTH_SHIFT = 0;
+    const int VAO_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    const int TEXTURE_SET_SHIFT = VAO_SHIFT + VAO_BITS;
+    const int PROGRAM_SHIFT = TEXTURE_SET_SHIFT + TEXTURE_SET_BITS;
+
+    static_assert(PROGRAM_SHIFT + PROGRAM_BITS == 64, "sort key has to fill 64 bits");
+
+    // ID of value in ids, a new one on first sight. IDs past the field width share the last value; that only
+    // costs sorting quality, binds always compare the real state
+    uint64_t idOf(std::unordered_map<unsigned int, uint64_t>& ids, unsigned int value, int bits)
+    {
+        auto found = ids.find(value);
+        if (found != ids.end())
+            return found->second;
+        uint64_t id = std::min<uint64_t>(ids.size(), (uint64_t(1) << bits) - 1);
+        ids[value] = id;
+        return id;
+    }
+
+    // true if both meshes bind the same textures to the same units
+    bool sameTextures(Mesh const& a, Mesh const& b)
+    {
+        if (a.textures.size() != b.textures.size())
+            return false;
+        for (size_t i = 0; i < a.textures.size(); i++)
+            if (a.textures[i].id != b.textures[i].id)
+                return false;
+        return true;
+    }
+
+    // non-negative floats compare like their bit patterns, keep the top DEPTH_BITS of them
+    uint64_t depthBits(float depth)
+    {
+        depth = std::max(depth, 0.0f);
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> (32 - DEPTH_BITS);
+    }
+}
+
+// constructor
+RenderQueue::RenderQueue()
+{
+    Sorted = RenderQueueStats{ 0, 0, 0, 0 };
+    Unsorted = RenderQueueStats{ 0, 0, 0, 0 };
+}
+
+// queues a mesh drawn with shader, the given model matrix and level of detail at a view distance of depth
+void RenderQueue::Add(Shader& shader, Mesh& mesh, glm::mat4 const& model, float depth, unsigned int lod)
+{
+    uint64_t key = idOf(programIds, shader.ID, PROGRAM_BITS) << PROGRAM_SHIFT
+        | textureSetId(mesh) << TEXTURE_SET_SHIFT
+        | idOf(vaoIds, mesh.VAO, VAO_BITS) << VAO_SHIFT
+        | depthBits(depth) << DEPTH_SHIFT;
+    items.push_back(DrawItem{ key, &shader, &mesh, model, lod });
+}
+
+// sorts and draws everything queued since the last Flush, then clears the queue
+void RenderQueue::Flush()
+{
+    PROFILE_GPU_SCOPE("RenderQueue::Flush");
+    Unsorted = countBinds(items);
+    std::stable_sort(items.begin(), items.end(), [](DrawItem const& a, DrawItem const& b) { return a.key < b.key; });
+    Sorted = countBinds(items);
+
+    // the same filtering countBinds models: only changed state is bound
+    Shader* currentShader = nullptr;
+    Mesh* currentTextures = nullptr;
+    unsigned int currentVAO = 0;
+    for (DrawItem& item : items)
+    {
+        Shader& shader = *item.shader;
+        Mesh& mesh = *item.mesh;
+
+        bool programChanged = !currentShader || currentShader->ID != shader.ID;
+        if (programChanged)
+        {
+            shader.use();
+            currentShader = &shader;
+            if (modelUniforms.find(shader.ID) == modelUniforms.end())
+            {
+                modelUniforms[shader.ID] = shader.getUniform("model");
+                normalMatrixUniforms[shader.ID] = shader.getUniform("normalMatrix");
+            }
+        }
+
+        // sampler uniforms belong to the program, so a new program rebinds the textures as well
+        if (programChanged || !sameTextures(*currentTextures, mesh))
+        {
+            mesh.BindTextures(shader);
+            currentTextures = &mesh;
+        }
+
+        if (currentVAO != mesh.VAO)
+        {
+            glBindVertexArray(mesh.VAO);
+            currentVAO = mesh.VAO;
+        }
+
+        shader.setMat4(modelUniforms[shader.ID], item.model);
+        shader.setMat3(normalMatrixUniforms[shader.ID], Shader::NormalMatrix(item.model));
+        mesh.DrawElements(shader, item.lod);
+    }
+
+    // set back to default
+    glActiveTexture(GL_TEXTURE0);
+    items.clear();
+}
+
+// texture set ID of a mesh
+uint64_t RenderQueue::textureSetId(Mesh const& mesh)
+{
+    textureSet.clear();
+    for (Texture const& texture : mesh.textures)
+        textureSet.push_back(texture.id);
+
+    auto found = textureSetIds.find(textureSet);
+    if (found != textureSetIds.end())
+        return found->second;
+    uint64_t id = std::min<uint64_t>(textureSetIds.size(), (uint64_t(1) << TEXTURE_SET_BITS) - 1);
+    textureSetIds[textureSet] = id;
+    return id;
+}
+
+// binds the items would cause in their current order, skipping binds of state that is already set
+RenderQueueStats RenderQueue::countBinds(std::vector<DrawItem> const& items)
+{
+    RenderQueueStats stats = { static_cast<unsigned int>(items.size()), 0, 0, 0 };
+    const DrawItem* previous = nullptr;
+    for (DrawItem const& item : items)
+    {
+        bool programChanged = !previous || previous->shader->ID != item.shader->ID;
+        if (programChanged)
+            stats.programBinds++;
+        if (programChanged || !sameTextures(*previous->mesh, *item.mesh))
+            stats.textureBinds += static_cast<unsigned int>(item.mesh->textures.size());
+        if (!previous || previous->mesh->VAO != item.mesh->VAO)
+            stats.vaoBinds++;
+        previous = &item;
+    }
+    return stats;
+}
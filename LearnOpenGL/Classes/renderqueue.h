@@ -0,0 +1,75 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "shader.h"
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// state changes of one frame's draws
+struct RenderQueueStats {
+    unsigned int items;
+    unsigned int programBinds;
+    unsigned int textureBinds;
+    unsigned int vaoBinds;
+};
+
+// Collects a frame's draw items and submits them sorted by a 64-bit key, so items sharing a program, texture set
+// and VAO are drawn back to back and redundant binds are skipped. Key layout, most significant bits first:
+//
+//   program (8) | texture set (20) | VAO (8) | depth (28)
+//
+// Program, texture set and VAO are small IDs handed out on first sight; depth is the top 28 bits of the
+// non-negative float view distance, so equal state is drawn front to back.
+class RenderQueue
+{
+public:
+    // counters of the last Flush: as submitted (sorted) and as the items were added (insertion order)
+    RenderQueueStats Sorted;
+    RenderQueueStats Unsorted;
+
+    // constructor
+    RenderQueue();
+
+    // queues a mesh drawn with shader, the given model matrix and level of detail at a view distance of depth
+    void Add(Shader& shader, Mesh& mesh, glm::mat4 const& model, float depth, unsigned int lod = 0);
+
+    // sorts and draws everything queued since the last Flush, then clears the queue
+    void Flush();
+
+private:
+    struct DrawItem {
+        uint64_t key;
+        Shader* shader;
+        Mesh* mesh;
+        glm::mat4 model;
+        unsigned int lod;
+    };
+
+    std::vector<DrawItem> items;
+
+    // small IDs of the key fields, stable for the lifetime of the queue
+    std::unordered_map<unsigned int, uint64_t> programIds;
+    std::unordered_map<unsigned int, uint64_t> vaoIds;
+    std::map<std::vector<unsigned int>, uint64_t> textureSetIds;
+    std::vector<unsigned int> textureSet;
+
+    // "model" and "normalMatrix" uniforms per program
+    std::unordered_map<unsigned int, UniformHandle> modelUniforms;
+    std::unordered_map<unsigned int, UniformHandle> normalMatrixUniforms;
+
+    // texture set ID of a mesh
+    uint64_t textureSetId(Mesh const& mesh);
+
+    // binds the items would cause in their current order, skipping binds of state that is already set
+    static RenderQueueStats countBinds(std::vector<DrawItem> const& items);
+};
+
+#endif
@@ -0,0 +1,428 @@
+#include "scenebvh.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    // SAH constants: a node visit costs as much as TRAVERSAL_COST box tests
+    const float TRAVERSAL_COST = 1.0f;
+    const int SAH_BINS = 16;
+    const unsigned int MAX_LEAF_SIZE = 8;
+
+    // Refit rebuilds once the cost grew by this factor over the cost right after Build
+    const float REBUILD_COST_RATIO = 1.5f;
+
+    // -1 outside, 0 intersecting, 1 inside the frustum
+    int classify(Frustum const& frustum, BoundingBox const& box)
+    {
+        if (box.min.x > box.max.x)
+            return -1;
+        glm::vec3 center = 0.5f * (box.min + box.max);
+        glm::vec3 extent = 0.5f * (box.max - box.min);
+        int result = 1;
+        for (glm::vec4 const& plane : frustum.planes)
+        {
+            glm::vec3 normal(plane);
+            float distance = glm::dot(normal, center) + plane.w;
+            float radius = glm::dot(glm::abs(normal), extent);
+            if (distance + radius < 0.0f)
+                return -1;
+            if (distance - radius < 0.0f)
+                result = 0;
+        }
+        return result;
+    }
+}
+
+// constructor
+SceneBvh::SceneBvh()
+{
+    structureChanged = false;
+    liveObjects = 0;
+    depth = 0;
+    builds = 0;
+    refittedLeaves = 0;
+    builtCost = 0.0f;
+}
+
+// adds an object and returns its handle
+unsigned int SceneBvh::Insert(BoundingBox const& box)
+{
+    unsigned int object;
+    if (!freeObjects.empty())
+    {
+        object = freeObjects.back();
+        freeObjects.pop_back();
+    }
+    else
+    {
+        object = static_cast<unsigned int>(boxes.size());
+        boxes.emplace_back();
+        objectLeaf.push_back(SCENE_BVH_INVALID);
+        live.push_back(0);
+    }
+    boxes[object] = box;
+    objectLeaf[object] = SCENE_BVH_INVALID;
+    live[object] = 1;
+    liveObjects++;
+    structureChanged = true;
+    return object;
+}
+
+// moves an object
+void SceneBvh::Update(unsigned int object, BoundingBox const& box)
+{
+    if (object >= boxes.size() || !live[object])
+        return;
+    boxes[object] = box;
+    if (objectLeaf[object] != SCENE_BVH_INVALID)
+        dirtyLeaves.push_back(objectLeaf[object]);
+}
+
+// removes an object
+void SceneBvh::Remove(unsigned int object)
+{
+    if (object >= boxes.size() || !live[object])
+        return;
+
+    // take it out of its leaf right away so queries stop returning it after the next Refit
+    unsigned int leaf = objectLeaf[object];
+    if (leaf != SCENE_BVH_INVALID)
+    {
+        Node& node = nodes[leaf];
+        for (unsigned int i = node.first; i < node.first + node.count; i++)
+        {
+            if (leafObjects[i] == object)
+            {
+                std::swap(leafObjects[i], leafObjects[node.first + node.count - 1]);
+                node.count--;
+                break;
+            }
+        }
+        dirtyLeaves.push_back(leaf);
+    }
+
+    boxes[object] = BoundingBox();
+    objectLeaf[object] = SCENE_BVH_INVALID;
+    live[object] = 0;
+    liveObjects--;
+    freeObjects.push_back(object);
+    structureChanged = true;
+}
+
+// builds the tree from scratch over every object
+void SceneBvh::Build()
+{
+    nodes.clear();
+    leafObjects.clear();
+    dirtyLeaves.clear();
+    structureChanged = false;
+    refittedLeaves = 0;
+    depth = 0;
+    builds++;
+
+    std::vector<glm::vec3> centroids(boxes.size());
+    for (unsigned int object = 0; object < boxes.size(); object++)
+    {
+        if (!live[object])
+            continue;
+        leafObjects.push_back(object);
+        centroids[object] = 0.5f * (boxes[object].min + boxes[object].max);
+    }
+
+    Node root;
+    root.left = 0;
+    root.first = 0;
+    root.count = static_cast<unsigned int>(leafObjects.size());
+    root.parent = SCENE_BVH_INVALID;
+    nodes.reserve(2 * leafObjects.size() + 1);
+    nodes.push_back(root);
+
+    // (node, depth) pairs still to split
+    std::vector<std::pair<unsigned int, unsigned int>> stack;
+    stack.push_back(std::make_pair(0u, 1u));
+    while (!stack.empty())
+    {
+        std::pair<unsigned int, unsigned int> entry = stack.back();
+        stack.pop_back();
+        depth = std::max(depth, entry.second);
+        split(entry.first, centroids, entry.second, stack);
+    }
+    builtCost = cost();
+}
+
+// applies the Inserts, Updates and Removes since the last Build / Refit
+void SceneBvh::Refit()
+{
+    if (structureChanged || nodes.empty())
+    {
+        Build();
+        return;
+    }
+    if (dirtyLeaves.empty())
+        return;
+
+    for (unsigned int leaf : dirtyLeaves)
+    {
+        Node& node = nodes[leaf];
+        BoundingBox box;
+        for (unsigned int i = node.first; i < node.first + node.count; i++)
+            box = Union(box, boxes[leafObjects[i]]);
+        node.box = box;
+
+        // the path to the root, stopping where a box did not change since everything above is still right then
+        unsigned int parent = node.parent;
+        while (parent != SCENE_BVH_INVALID)
+        {
+            Node& ancestor = nodes[parent];
+            BoundingBox merged = Union(nodes[ancestor.left].box, nodes[ancestor.left + 1].box);
+            if (merged.min == ancestor.box.min && merged.max == ancestor.box.max)
+                break;
+            ancestor.box = merged;
+            parent = ancestor.parent;
+        }
+    }
+    refittedLeaves += static_cast<unsigned int>(dirtyLeaves.size());
+    dirtyLeaves.clear();
+
+    // refitting keeps the topology, which gets loose once objects moved far from where they were built
+    if (refittedLeaves >= liveObjects && cost() > REBUILD_COST_RATIO * builtCost)
+        Build();
+}
+
+// appends every object whose box intersects frustum to objects
+void SceneBvh::QueryFrustum(Frustum const& frustum, std::vector<unsigned int>& objects) const
+{
+    if (nodes.empty())
+        return;
+
+    // (node, inside) pairs: below a node that is entirely inside nothing has to be tested
+    std::vector<std::pair<unsigned int, bool>> stack;
+    stack.reserve(2 * depth + 2);
+    stack.push_back(std::make_pair(0u, false));
+    while (!stack.empty())
+    {
+        std::pair<unsigned int, bool> entry = stack.back();
+        stack.pop_back();
+        Node const& node = nodes[entry.first];
+
+        bool inside = entry.second;
+        if (!inside)
+        {
+            int side = classify(frustum, node.box);
+            if (side < 0)
+                continue;
+            inside = side > 0;
+        }
+
+        if (node.left != 0)
+        {
+            stack.push_back(std::make_pair(node.left + 1, inside));
+            stack.push_back(std::make_pair(node.left, inside));
+            continue;
+        }
+        for (unsigned int i = node.first; i < node.first + node.count; i++)
+            if (inside || frustum.Intersects(boxes[leafObjects[i]]))
+                objects.push_back(leafObjects[i]);
+    }
+}
+
+// nearest object whose box the ray enters before maxDistance
+bool SceneBvh::Raycast(Ray const& ray, RayHit& hit, float maxDistance) const
+{
+    hit = RayHit();
+    float distance;
+    if (nodes.empty() || !IntersectRay(ray, nodes[0].box, maxDistance, distance))
+        return false;
+
+    // (node, entry distance) pairs, the nearer child is visited first so later subtrees are pruned by the hit
+    std::vector<std::pair<unsigned int, float>> stack;
+    stack.reserve(2 * depth + 2);
+    stack.push_back(std::make_pair(0u, distance));
+    while (!stack.empty())
+    {
+        std::pair<unsigned int, float> entry = stack.back();
+        stack.pop_back();
+        if (entry.second > std::min(hit.distance, maxDistance))
+            continue;
+        Node const& node = nodes[entry.first];
+
+        if (node.left == 0)
+        {
+            for (unsigned int i = node.first; i < node.first + node.count; i++)
+            {
+                unsigned int object = leafObjects[i];
+                if (IntersectRay(ray, boxes[object], std::min(hit.distance, maxDistance), distance) && distance < hit.distance)
+                {
+                    hit.object = object;
+                    hit.distance = distance;
+                }
+            }
+            continue;
+        }
+
+        float leftDistance, rightDistance;
+        bool leftHit = IntersectRay(ray, nodes[node.left].box, maxDistance, leftDistance);
+        bool rightHit = IntersectRay(ray, nodes[node.left + 1].box, maxDistance, rightDistance);
+        if (leftHit && rightHit)
+        {
+            bool leftFirst = leftDistance <= rightDistance;
+            stack.push_back(leftFirst ? std::make_pair(node.left + 1, rightDistance) : std::make_pair(node.left, leftDistance));
+            stack.push_back(leftFirst ? std::make_pair(node.left, leftDistance) : std::make_pair(node.left + 1, rightDistance));
+        }
+        else if (leftHit)
+            stack.push_back(std::make_pair(node.left, leftDistance));
+        else if (rightHit)
+            stack.push_back(std::make_pair(node.left + 1, rightDistance));
+    }
+    return hit.object != SCENE_BVH_INVALID;
+}
+
+// current box of an object
+BoundingBox const& SceneBvh::Bounds(unsigned int object) const
+{
+    return boxes[object];
+}
+
+// current counters
+SceneBvhStats SceneBvh::Stats() const
+{
+    SceneBvhStats stats;
+    stats.objects = liveObjects;
+    stats.nodes = static_cast<unsigned int>(nodes.size());
+    stats.depth = depth;
+    stats.builds = builds;
+    stats.refittedLeaves = refittedLeaves;
+    stats.cost = cost();
+    return stats;
+}
+
+// splits node along the best binned SAH plane, or leaves it a leaf when that is cheaper
+void SceneBvh::split(unsigned int index, std::vector<glm::vec3> const& centroids, unsigned int nodeDepth,
+    std::vector<std::pair<unsigned int, unsigned int>>& stack)
+{
+    unsigned int first = nodes[index].first;
+    unsigned int count = nodes[index].count;
+
+    BoundingBox box, centroidBox;
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        unsigned int object = leafObjects[i];
+        box = Union(box, boxes[object]);
+        BoundingBox point;
+        point.min = point.max = centroids[object];
+        centroidBox = Union(centroidBox, point);
+    }
+    nodes[index].box = box;
+    for (unsigned int i = first; i < first + count; i++)
+        objectLeaf[leafObjects[i]] = index;
+    if (count <= 1)
+        return;
+
+    // sweep the bins of every axis for the plane with the lowest leftArea * leftCount + rightArea * rightCount
+    struct Bin {
+        BoundingBox box;
+        unsigned int count = 0;
+    };
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    int bestPlane = 0;
+    glm::vec3 extent = centroidBox.max - centroidBox.min;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (extent[axis] <= 0.0f)
+            continue;
+        Bin bins[SAH_BINS];
+        float scale = SAH_BINS / extent[axis];
+        for (unsigned int i = first; i < first + count; i++)
+        {
+            unsigned int object = leafObjects[i];
+            int bin = std::min(SAH_BINS - 1, static_cast<int>((centroids[object][axis] - centroidBox.min[axis]) * scale));
+            bins[bin].box = Union(bins[bin].box, boxes[object]);
+            bins[bin].count++;
+        }
+
+        // right to left sweep first, so the left to right one can combine both sides per plane
+        float rightArea[SAH_BINS - 1];
+        unsigned int rightCount[SAH_BINS - 1];
+        BoundingBox sweep;
+        unsigned int sweepCount = 0;
+        for (int plane = SAH_BINS - 1; plane > 0; plane--)
+        {
+            sweep = Union(sweep, bins[plane].box);
+            sweepCount += bins[plane].count;
+            rightArea[plane - 1] = SurfaceArea(sweep);
+            rightCount[plane - 1] = sweepCount;
+        }
+        sweep = BoundingBox();
+        sweepCount = 0;
+        for (int plane = 0; plane < SAH_BINS - 1; plane++)
+        {
+            sweep = Union(sweep, bins[plane].box);
+            sweepCount += bins[plane].count;
+            if (sweepCount == 0 || rightCount[plane] == 0)
+                continue;
+            float planeCost = SurfaceArea(sweep) * sweepCount + rightArea[plane] * rightCount[plane];
+            if (planeCost < bestCost)
+            {
+                bestCost = planeCost;
+                bestAxis = axis;
+                bestPlane = plane;
+            }
+        }
+    }
+
+    // leaf if testing every object is cheaper than a visit plus the split, as long as the leaf stays small
+    float area = SurfaceArea(box);
+    bool splitPays = bestAxis >= 0 && TRAVERSAL_COST * area + bestCost < count * area;
+    if (!splitPays && count <= MAX_LEAF_SIZE)
+        return;
+
+    unsigned int middle;
+    if (bestAxis >= 0)
+    {
+        float scale = SAH_BINS / extent[bestAxis];
+        float minimum = centroidBox.min[bestAxis];
+        middle = static_cast<unsigned int>(std::partition(leafObjects.begin() + first, leafObjects.begin() + first + count,
+            [&](unsigned int object)
+            {
+                return std::min(SAH_BINS - 1, static_cast<int>((centroids[object][bestAxis] - minimum) * scale)) <= bestPlane;
+            }) - leafObjects.begin());
+    }
+    else
+    {
+        // every centroid in one point, halve the range so leaves stay small
+        middle = first + count / 2;
+    }
+
+    unsigned int left = static_cast<unsigned int>(nodes.size());
+    Node child;
+    child.left = 0;
+    child.parent = index;
+    child.first = first;
+    child.count = middle - first;
+    nodes.push_back(child);
+    child.first = middle;
+    child.count = first + count - middle;
+    nodes.push_back(child);
+
+    nodes[index].left = left;
+    nodes[index].count = 0;
+    stack.push_back(std::make_pair(left, nodeDepth + 1));
+    stack.push_back(std::make_pair(left + 1, nodeDepth + 1));
+}
+
+// SAH cost of the current tree
+float SceneBvh::cost() const
+{
+    if (nodes.empty())
+        return 0.0f;
+    float rootArea = SurfaceArea(nodes[0].box);
+    if (rootArea <= 0.0f)
+        return 0.0f;
+    float total = 0.0f;
+    for (Node const& node : nodes)
+        total += SurfaceArea(node.box) * (node.left != 0 ? TRAVERSAL_COST : static_cast<float>(node.count));
+    return total / rootArea;
+}
@@ -0,0 +1,107 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#include "bounds.h"
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+// object handle that refers to nothing
+const unsigned int SCENE_BVH_INVALID = 0xffffffff;
+
+// nearest object a ray hit and where it entered the object's box
+struct RayHit {
+    unsigned int object = SCENE_BVH_INVALID;
+    float distance = FLT_MAX;
+};
+
+// shape of the tree, e.g. for the stats window
+struct SceneBvhStats {
+    unsigned int objects;
+    unsigned int nodes;
+    unsigned int depth;
+    unsigned int builds;
+    unsigned int refittedLeaves; // since the last Build
+    float cost;                  // SAH cost relative to testing the root box, grows as refits loosen the tree
+};
+
+// Bounding volume hierarchy over world space boxes of scene objects (meshes or whole models), so frustum
+// queries and ray picks visit only the subtrees they touch instead of every object.
+//
+// Build creates the tree top down with a binned surface area heuristic. Moving objects only refit it: Update
+// records the new box and Refit grows or shrinks the boxes on the path to the root, keeping the topology. Once
+// about every object has moved since the last Build, Refit rebuilds if the SAH cost got too far above the
+// freshly built one. Inserting or removing objects changes the structure and is applied by the next Refit.
+// Queries see the state of the last Build / Refit. Needs no OpenGL context.
+class SceneBvh
+{
+public:
+    // constructor
+    SceneBvh();
+
+    // adds an object and returns its handle. Handles of removed objects are reused
+    unsigned int Insert(BoundingBox const& box);
+
+    // moves an object
+    void Update(unsigned int object, BoundingBox const& box);
+
+    // removes an object, its handle becomes invalid
+    void Remove(unsigned int object);
+
+    // builds the tree from scratch over every object
+    void Build();
+
+    // applies the Inserts, Updates and Removes since the last Build / Refit
+    void Refit();
+
+    // appends every object whose box intersects frustum to objects
+    void QueryFrustum(Frustum const& frustum, std::vector<unsigned int>& objects) const;
+
+    // nearest object whose box the ray enters before maxDistance. False if there is none
+    bool Raycast(Ray const& ray, RayHit& hit, float maxDistance = FLT_MAX) const;
+
+    // current box of an object
+    BoundingBox const& Bounds(unsigned int object) const;
+
+    // current counters
+    SceneBvhStats Stats() const;
+
+private:
+    // interior nodes have their children at left and left + 1, leaves (left == 0, the root is never a child)
+    // own leafObjects[first, first + count)
+    struct Node {
+        BoundingBox box;
+        unsigned int left;
+        unsigned int first;
+        unsigned int count;
+        unsigned int parent;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<unsigned int> leafObjects;
+
+    // per object handle
+    std::vector<BoundingBox> boxes;
+    std::vector<unsigned int> objectLeaf; // SCENE_BVH_INVALID until the object is in the tree
+    std::vector<uint8_t> live;
+    std::vector<unsigned int> freeObjects;
+
+    std::vector<unsigned int> dirtyLeaves;
+    bool structureChanged;
+
+    unsigned int liveObjects;
+    unsigned int depth;
+    unsigned int builds;
+    unsigned int refittedLeaves;
+    float builtCost;
+
+    // splits node along the best binned SAH plane, or leaves it a leaf when that is cheaper
+    void split(unsigned int index, std::vector<glm::vec3> const& centroids, unsigned int nodeDepth,
+        std::vector<std::pair<unsigned int, unsigned int>>& stack);
+
+    // SAH cost of the current tree
+    float cost() const;
+};
+
+#endif
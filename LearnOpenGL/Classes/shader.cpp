@@ -1,6 +1,8 @@
 #include "shader.h"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+int Shader::glslVersion = 0;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines)
 {
 	// 1. Retrieve vertex and fragment source code from filepath
 	std::string vertexCode;
@@ -23,8 +25,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		vShaderFile.close();
 		fShaderFile.close();
 		// Convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+		vertexCode = insertDefines(overrideVersion(vShaderStream.str()), defines);
+		fragmentCode = insertDefines(overrideVersion(fShaderStream.str()), defines);
 	}
 	catch (std::ifstream::failure e)
 	{
@@ -55,6 +57,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	glAttachShader(ID, fragment);
 	glLinkProgram(ID);
 	checkCompileError(ID, "PROGRAM");
+	reflectUniforms();
 
 
 	// Delete shaders; they're linked into program so no longer needed
@@ -69,27 +72,161 @@ void Shader::use()
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	glUniform1i(uniformLocation(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1i(uniformLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1f(uniformLocation(name), value);
+}
+
+void Shader::setMat3(const std::string& name, glm::mat3 value) const
+{
+	glUniformMatrix3fv(uniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::setMat4(const std::string& name, glm::mat4 value) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+	glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::setVec3(const std::string& name, glm::vec3 value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	glUniform3fv(uniformLocation(name), 1, &value[0]);
+}
+
+UniformHandle Shader::getUniform(const std::string& name) const
+{
+	UniformHandle uniform;
+	uniform.location = uniformLocation(name);
+	return uniform;
+}
+
+void Shader::setBool(UniformHandle uniform, bool value) const
+{
+	glUniform1i(uniform.location, (int)value);
+}
+
+void Shader::setInt(UniformHandle uniform, int value) const
+{
+	glUniform1i(uniform.location, value);
+}
+
+void Shader::setFloat(UniformHandle uniform, float value) const
+{
+	glUniform1f(uniform.location, value);
+}
+
+void Shader::setMat3(UniformHandle uniform, const glm::mat3& value) const
+{
+	glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setMat4(UniformHandle uniform, const glm::mat4& value) const
+{
+	glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setVec3(UniformHandle uniform, const glm::vec3& value) const
+{
+	glUniform3fv(uniform.location, 1, &value[0]);
+}
+
+glm::mat3 Shader::NormalMatrix(const glm::mat4& model)
+{
+	glm::mat3 m(model);
+
+	// columns of a rotation times a uniform scale are orthogonal and of equal length
+	float xx = glm::dot(m[0], m[0]);
+	float yy = glm::dot(m[1], m[1]);
+	float zz = glm::dot(m[2], m[2]);
+	float tolerance = 1e-5f * xx;
+	if (xx > 0.0f && std::abs(xx - yy) <= tolerance && std::abs(xx - zz) <= tolerance
+		&& std::abs(glm::dot(m[0], m[1])) <= tolerance && std::abs(glm::dot(m[0], m[2])) <= tolerance
+		&& std::abs(glm::dot(m[1], m[2])) <= tolerance)
+		return xx == 1.0f ? m : m * (1.0f / xx);
+
+	// non-uniform scale or shear
+	return glm::transpose(glm::inverse(m));
+}
+
+// Insert the defines after the #version line, which has to stay first
+std::string Shader::insertDefines(const std::string& code, const std::string& defines)
+{
+	if (defines.empty())
+		return code;
+	size_t version = code.find("#version");
+	size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+	if (lineEnd == std::string::npos)
+		return defines + code;
+	return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+}
+
+// Replace the number of the #version line with glslVersion, if set
+std::string Shader::overrideVersion(const std::string& code)
+{
+	size_t version = code.find("#version");
+	if (glslVersion == 0 || version == std::string::npos)
+		return code;
+	size_t number = code.find_first_of("0123456789", version);
+	size_t numberEnd = number == std::string::npos ? std::string::npos : code.find_first_not_of("0123456789", number);
+	if (numberEnd == std::string::npos)
+		return code;
+	return code.substr(0, number) + std::to_string(glslVersion) + code.substr(numberEnd);
+}
+
+// GLSL version every shader built afterwards is compiled with
+void Shader::SetGlslVersion(int version)
+{
+	glslVersion = version;
+}
+
+// Query every active uniform of the linked program once, so setters never ask the driver for a location
+void Shader::reflectUniforms()
+{
+	uniformLocations.clear();
+
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxLength);
+
+	std::vector<char> name(maxLength > 0 ? maxLength : 1);
+	const GLenum properties[] = { GL_LOCATION, GL_ARRAY_SIZE };
+	for (GLint i = 0; i < count; i++)
+	{
+		GLint values[2];
+		glGetProgramResourceiv(ID, GL_UNIFORM, i, 2, properties, 2, NULL, values);
+		GLint location = values[0];
+		GLint arraySize = values[1];
+		// members of uniform blocks have no location
+		if (location < 0)
+			continue;
+
+		glGetProgramResourceName(ID, GL_UNIFORM, i, (GLsizei)name.size(), NULL, name.data());
+		std::string uniformName = name.data();
+		uniformLocations[uniformName] = location;
+
+		// arrays are reported as "name[0]"; also map "name" and every element, whose locations are consecutive
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+		{
+			std::string baseName = uniformName.substr(0, uniformName.size() - 3);
+			uniformLocations[baseName] = location;
+			for (GLint element = 1; element < arraySize; element++)
+				uniformLocations[baseName + "[" + std::to_string(element) + "]"] = location + element;
+		}
+	}
+}
+
+int Shader::uniformLocation(const std::string& name) const
+{
+	auto found = uniformLocations.find(name);
+	return found != uniformLocations.end() ? found->second : -1;
 }
 
 void Shader::checkCompileError(unsigned int shader, std::string type)
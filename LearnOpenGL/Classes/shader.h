@@ -10,6 +10,15 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// A uniform resolved once with Shader::getUniform, then set any number of times without a name lookup.
+// location is -1 when the program has no such active uniform; setting it is then a no-op like in GL.
+struct UniformHandle
+{
+	int location = -1;
+};
 
 class Shader
 {
@@ -17,8 +26,9 @@ public:
 	// Shader program ID
 	unsigned int ID;
 
-	// Default contructor reads and builds shader
-	Shader(const char* vertexPath, const char* fragmentPath);
+	// Default contructor reads and builds shader. defines (e.g. "#define NAME\n") is inserted into both
+	// stages right after their #version line
+	Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
 
 	// Activate shader
 	void use();
@@ -26,10 +36,37 @@ public:
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
+	void setMat3(const std::string& name, glm::mat3 value) const;
 	void setMat4(const std::string& name, glm::mat4 value) const;
 	void setVec3(const std::string& name, glm::vec3 value) const;
 
+	// Resolve a uniform once; use the handle overloads below on hot paths
+	UniformHandle getUniform(const std::string& name) const;
+	void setBool(UniformHandle uniform, bool value) const;
+	void setInt(UniformHandle uniform, int value) const;
+	void setFloat(UniformHandle uniform, float value) const;
+	void setMat3(UniformHandle uniform, const glm::mat3& value) const;
+	void setMat4(UniformHandle uniform, const glm::mat4& value) const;
+	void setVec3(UniformHandle uniform, const glm::vec3& value) const;
+
+	// Normal matrix of a model matrix, transpose(inverse(mat3(model))). Rigid and uniformly scaled transforms
+	// skip the inverse: for model = s * R it is R / s, which is mat3(model) / s^2
+	static glm::mat3 NormalMatrix(const glm::mat4& model);
+
+	// GLSL version every shader built afterwards is compiled with, replacing the number of its #version line.
+	// 0 (the default) keeps the files' 460; a 4.5 context such as Mesa's llvmpipe needs 450
+	static void SetGlslVersion(int version);
+
 private:
+	static int glslVersion;
+
+	// Locations of all active uniforms, reflected once after linking
+	std::unordered_map<std::string, int> uniformLocations;
+
+	void reflectUniforms();
+	static std::string insertDefines(const std::string& code, const std::string& defines);
+	static std::string overrideVersion(const std::string& code);
+	int uniformLocation(const std::string& name) const;
 
 	void checkCompileError(unsigned int shader, std::string type);
 };
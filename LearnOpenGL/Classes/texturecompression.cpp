@@ -0,0 +1,464 @@
+#include "texturecompression.h"
+#include "mipmaps.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    // DDS_PIXELFORMAT and DDS_HEADER of the DDS file format, the header follows the 4 byte magic "DDS "
+    struct DdsPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t bitMasks[4];
+    };
+
+    struct DdsHeader {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DdsPixelFormat format;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER is 124 bytes");
+
+    const uint32_t DDSD_CAPS = 0x1;
+    const uint32_t DDSD_HEIGHT = 0x2;
+    const uint32_t DDSD_WIDTH = 0x4;
+    const uint32_t DDSD_PIXELFORMAT = 0x1000;
+    const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    const uint32_t DDSD_LINEARSIZE = 0x80000;
+    const uint32_t DDPF_FOURCC = 0x4;
+    const uint32_t DDSCAPS_COMPLEX = 0x8;
+    const uint32_t DDSCAPS_TEXTURE = 0x1000;
+    const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+    constexpr uint32_t fourCC(char a, char b, char c, char d)
+    {
+        return static_cast<uint32_t>(static_cast<unsigned char>(a)) | static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8
+            | static_cast<uint32_t>(static_cast<unsigned char>(c)) << 16 | static_cast<uint32_t>(static_cast<unsigned char>(d)) << 24;
+    }
+
+    // the cache key lives in the reserved words of the header: tag, version, params, source components, source time
+    const uint32_t CACHE_TAG = fourCC('L', 'O', 'G', 'L');
+    const uint32_t CACHE_FLAG_FLIP = 1 << 0;
+
+    // the params bits of the cache key, the MipmapMode above the flip flag
+    uint32_t paramsKey(TextureParams const& params)
+    {
+        return (params.flipVertically ? CACHE_FLAG_FLIP : 0) | static_cast<uint32_t>(params.mipmapMode) << 1;
+    }
+
+    // legacy FourCC of a block format, 0 if it has none
+    uint32_t formatFourCC(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return fourCC('D', 'X', 'T', '1');
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return fourCC('D', 'X', 'T', '5');
+        case GL_COMPRESSED_RED_RGTC1: return fourCC('A', 'T', 'I', '1');
+        case GL_COMPRESSED_RG_RGTC2: return fourCC('A', 'T', 'I', '2');
+        default: return 0;
+        }
+    }
+
+    GLenum fourCCFormat(uint32_t code)
+    {
+        if (code == fourCC('D', 'X', 'T', '1'))
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        if (code == fourCC('D', 'X', 'T', '5'))
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        if (code == fourCC('A', 'T', 'I', '1'))
+            return GL_COMPRESSED_RED_RGTC1;
+        if (code == fourCC('A', 'T', 'I', '2'))
+            return GL_COMPRESSED_RG_RGTC2;
+        return 0;
+    }
+
+    // modification time of the source file, part of the cache key
+    bool sourceTime(std::string const& path, int64_t& time)
+    {
+        std::error_code ec;
+        auto stamp = std::filesystem::last_write_time(path, ec);
+        if (ec)
+            return false;
+        time = static_cast<int64_t>(stamp.time_since_epoch().count());
+        return true;
+    }
+
+    // level layout of a mip chain down to 1x1 inside one buffer, finest level first. Returns the total size
+    size_t layoutLevels(GLenum format, int width, int height, std::vector<MipLevel>& levels)
+    {
+        size_t offset = 0;
+        levels.clear();
+        while (true)
+        {
+            size_t size = CompressedLevelSize(format, width, height);
+            levels.push_back(MipLevel{ width, height, offset, size });
+            offset += size;
+            if (width == 1 && height == 1)
+                return offset;
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+    }
+
+    // RGB565 endpoint of a color in [0, 255], and back with the bit replication decoders use
+    uint16_t to565(glm::vec3 color)
+    {
+        glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+        int r = static_cast<int>(c.r * 31.0f / 255.0f + 0.5f);
+        int g = static_cast<int>(c.g * 63.0f / 255.0f + 0.5f);
+        int b = static_cast<int>(c.b * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    glm::vec3 from565(uint16_t color)
+    {
+        int r = color >> 11;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    // BC1 block of 16 colors with endpoints c0 and c1, always in 4 color mode. Returns the squared error
+    float encodeBc1Endpoints(glm::vec3 const colors[16], uint16_t c0, uint16_t c1, unsigned char* out, float weights[16])
+    {
+        // c0 > c1 selects the 4 color mode, equal endpoints only use index 0
+        if (c0 < c1)
+            std::swap(c0, c1);
+        glm::vec3 palette[4] = { from565(c0), from565(c1) };
+        palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+        palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+        const float PALETTE_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        int used = c0 == c1 ? 1 : 4;
+
+        uint32_t indices = 0;
+        float error = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            float bestDistance = FLT_MAX;
+            for (int j = 0; j < used; j++)
+            {
+                glm::vec3 d = colors[i] - palette[j];
+                float distance = glm::dot(d, d);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = j;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+            weights[i] = PALETTE_WEIGHTS[best];
+            error += bestDistance;
+        }
+
+        out[0] = static_cast<unsigned char>(c0 & 0xFF);
+        out[1] = static_cast<unsigned char>(c0 >> 8);
+        out[2] = static_cast<unsigned char>(c1 & 0xFF);
+        out[3] = static_cast<unsigned char>(c1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+        return error;
+    }
+
+    // BC1 block of 16 colors: endpoints on the principal axis of the colors, then refined by least squares
+    void encodeBc1(glm::vec3 const colors[16], unsigned char* out)
+    {
+        glm::vec3 mean(0.0f);
+        for (int i = 0; i < 16; i++)
+            mean += colors[i];
+        mean /= 16.0f;
+
+        glm::mat3 covariance(0.0f);
+        for (int i = 0; i < 16; i++)
+        {
+            glm::vec3 d = colors[i] - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+
+        // power iteration converges on the axis of largest variance within a few steps
+        glm::vec3 axis(1.0f, 1.0f, 1.0f);
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 next = covariance * axis;
+            float length = glm::length(next);
+            if (length < 1e-6f)
+                break;
+            axis = next / length;
+        }
+        axis = glm::normalize(axis);
+
+        float minT = FLT_MAX;
+        float maxT = -FLT_MAX;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = glm::dot(colors[i] - mean, axis);
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        float weights[16];
+        float error = encodeBc1Endpoints(colors, to565(mean + axis * maxT), to565(mean + axis * minT), out, weights);
+        if (error == 0.0f)
+            return;
+
+        // endpoints minimizing the squared error of the chosen indices: the normal equations of
+        // sum |w * a + (1 - w) * b - color|^2
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        glm::vec3 ax(0.0f), bx(0.0f);
+        for (int i = 0; i < 16; i++)
+        {
+            float w = weights[i];
+            aa += w * w;
+            ab += w * (1.0f - w);
+            bb += (1.0f - w) * (1.0f - w);
+            ax += w * colors[i];
+            bx += (1.0f - w) * colors[i];
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f)
+            return;
+        glm::vec3 a = (bb * ax - ab * bx) / det;
+        glm::vec3 b = (aa * bx - ab * ax) / det;
+
+        unsigned char refined[8];
+        if (encodeBc1Endpoints(colors, to565(a), to565(b), refined, weights) < error)
+            std::memcpy(out, refined, sizeof(refined));
+    }
+
+    // BC4 block of 16 values, in the 8 value mode between their minimum and maximum
+    void encodeBc4(unsigned char const values[16], unsigned char* out)
+    {
+        unsigned char a0 = *std::max_element(values, values + 16);
+        unsigned char a1 = *std::min_element(values, values + 16);
+        float palette[8] = { static_cast<float>(a0), static_cast<float>(a1) };
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+
+        uint64_t indices = 0;
+        if (a0 != a1)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                for (int j = 1; j < 8; j++)
+                    if (std::fabs(values[i] - palette[j]) < std::fabs(values[i] - palette[best]))
+                        best = j;
+                indices |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    // compresses one mip level into out, blocks past the edge repeat the last row and column
+    void compressLevel(unsigned char const* pixels, MipLevel const& level, int components, GLenum format, unsigned char* out)
+    {
+        int blocksX = (level.width + 3) / 4;
+        int blocksY = (level.height + 3) / 4;
+        for (int by = 0; by < blocksY; by++)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                unsigned char block[16][4] = {};
+                for (int i = 0; i < 16; i++)
+                {
+                    int x = std::min(bx * 4 + i % 4, level.width - 1);
+                    int y = std::min(by * 4 + i / 4, level.height - 1);
+                    std::memcpy(block[i], pixels + (static_cast<size_t>(y) * level.width + x) * components, components);
+                }
+
+                if (format == GL_COMPRESSED_RED_RGTC1 || format == GL_COMPRESSED_RG_RGTC2)
+                {
+                    // one BC4 block per channel
+                    for (int c = 0; c < components; c++)
+                    {
+                        unsigned char values[16];
+                        for (int i = 0; i < 16; i++)
+                            values[i] = block[i][c];
+                        encodeBc4(values, out);
+                        out += 8;
+                    }
+                    continue;
+                }
+
+                if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+                {
+                    // BC4 alpha block in front of the color block
+                    unsigned char alpha[16];
+                    for (int i = 0; i < 16; i++)
+                        alpha[i] = block[i][3];
+                    encodeBc4(alpha, out);
+                    out += 8;
+                }
+                glm::vec3 colors[16];
+                for (int i = 0; i < 16; i++)
+                    colors[i] = glm::vec3(block[i][0], block[i][1], block[i][2]);
+                encodeBc1(colors, out);
+                out += 8;
+            }
+        }
+    }
+
+    // block format of an image, RGBA images without transparent pixels drop their alpha
+    GLenum chooseFormat(TextureImage const& image)
+    {
+        switch (image.nrComponents)
+        {
+        case 1: return GL_COMPRESSED_RED_RGTC1;
+        case 2: return GL_COMPRESSED_RG_RGTC2;
+        case 3: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        default:
+            size_t pixels = static_cast<size_t>(image.width) * image.height;
+            for (size_t i = 0; i < pixels; i++)
+                if (image.levelData[i * 4 + 3] != 255)
+                    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        }
+    }
+}
+
+// picks the block format of an image and compresses its mip chain
+void CompressTexture(TextureImage& image)
+{
+    if (image.levels.empty() || image.compressedFormat != 0)
+        return;
+
+    GLenum format = chooseFormat(image);
+    std::vector<MipLevel> levels;
+    std::vector<unsigned char> compressed(layoutLevels(format, image.width, image.height, levels));
+    for (size_t i = 0; i < levels.size(); i++)
+        compressLevel(image.levelData.data() + image.levels[i].offset, image.levels[i], image.nrComponents, format,
+            compressed.data() + levels[i].offset);
+
+    image.compressedFormat = format;
+    image.levels = std::move(levels);
+    image.levelData = std::move(compressed);
+}
+
+// bytes of a width x height level in a block format
+size_t CompressedLevelSize(GLenum format, int width, int height)
+{
+    size_t blockBytes = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RED_RGTC1 ? 8 : 16;
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+// returns the path of the cache file that belongs to an image file
+std::string TextureCachePath(std::string const& path)
+{
+    return path + ".dds";
+}
+
+// reads the cached mip chain of an image file into image
+bool LoadCompressedTexture(std::string const& path, TextureParams const& params, TextureImage& image)
+{
+    int64_t modified;
+    std::ifstream file(TextureCachePath(path), std::ios::binary);
+    if (!file || !sourceTime(path, modified))
+        return false;
+
+    char magic[4];
+    DdsHeader header;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, "DDS ", 4) != 0
+        || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.size != sizeof(DdsHeader))
+        return false;
+
+    // header, compare against the cache key
+    int64_t cachedModified;
+    std::memcpy(&cachedModified, &header.reserved1[4], sizeof(cachedModified));
+    GLenum format = fourCCFormat(header.format.fourCC);
+    bool valid = header.reserved1[0] == CACHE_TAG && header.reserved1[1] == TEXTURE_CACHE_VERSION
+        && header.reserved1[2] == paramsKey(params) && cachedModified == modified
+        && format != 0 && header.width > 0 && header.height > 0 && header.reserved1[3] >= 1 && header.reserved1[3] <= 4;
+    if (!valid)
+        return false;
+
+    TextureImage cached;
+    cached.path = image.path;
+    cached.width = static_cast<int>(header.width);
+    cached.height = static_cast<int>(header.height);
+    cached.nrComponents = static_cast<int>(header.reserved1[3]);
+    cached.compressedFormat = format;
+    size_t size = layoutLevels(format, cached.width, cached.height, cached.levels);
+    if (header.mipMapCount != cached.levels.size())
+        return false;
+
+    cached.levelData.resize(size);
+    if (!file.read(reinterpret_cast<char*>(cached.levelData.data()), size))
+        return false;
+
+    image = std::move(cached);
+    return true;
+}
+
+// writes the compressed mip chain of an image file to its cache file
+bool SaveCompressedTexture(std::string const& path, TextureParams const& params, TextureImage const& image)
+{
+    int64_t modified;
+    if (image.compressedFormat == 0 || !sourceTime(path, modified))
+        return false;
+
+    DdsHeader header = {};
+    header.size = sizeof(DdsHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = static_cast<uint32_t>(image.height);
+    header.width = static_cast<uint32_t>(image.width);
+    header.pitchOrLinearSize = static_cast<uint32_t>(image.levels[0].size);
+    header.mipMapCount = static_cast<uint32_t>(image.levels.size());
+    header.reserved1[0] = CACHE_TAG;
+    header.reserved1[1] = TEXTURE_CACHE_VERSION;
+    header.reserved1[2] = paramsKey(params);
+    header.reserved1[3] = static_cast<uint32_t>(image.nrComponents);
+    std::memcpy(&header.reserved1[4], &modified, sizeof(modified));
+    header.format.size = sizeof(DdsPixelFormat);
+    header.format.flags = DDPF_FOURCC;
+    header.format.fourCC = formatFourCC(image.compressedFormat);
+    header.caps = DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP;
+
+    // write to a temporary file first so a crash never leaves a half written cache behind
+    std::string cachePath = TextureCachePath(path);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::TEXTURECACHE::FILE_NOT_WRITABLE " << cachePath << std::endl;
+            return false;
+        }
+
+        out.write("DDS ", 4);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(image.levelData.data()), image.levelData.size());
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    return !ec;
+}
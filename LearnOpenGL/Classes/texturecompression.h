@@ -0,0 +1,43 @@
+#ifndef TEXTURECOMPRESSION_H
+#define TEXTURECOMPRESSION_H
+
+#include <glad/glad.h>
+
+#include "textureloader.h"
+
+#include <cstddef>
+#include <string>
+
+// S3TC formats, part of GL_EXT_texture_compression_s3tc and missing from the generated loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// version of the texture cache layout and encoders, part of the cache key
+const unsigned int TEXTURE_CACHE_VERSION = 2;
+
+// Block compression of texture mip chains. Every 4x4 block of pixels is stored in 8 or 16 bytes: BC1 (DXT1) for
+// RGB and opaque RGBA images, BC3 (DXT5) for RGBA images with alpha, BC4 (RGTC1) for one channel and BC5 (RGTC2)
+// for two channel images. The full mip chain is compressed, the GPU cannot generate mipmaps of compressed images.
+// The result is cached as a DDS file next to the image file, keyed by the image file's modification time, the
+// load parameters and TEXTURE_CACHE_VERSION. Touches no GL state, so it is safe to call from worker threads
+
+// picks the block format of an image and replaces its mip chain (built by GenerateMipChain) by the compressed one
+void CompressTexture(TextureImage& image);
+
+// bytes of a width x height level in a block format
+size_t CompressedLevelSize(GLenum format, int width, int height);
+
+// returns the path of the cache file that belongs to an image file
+std::string TextureCachePath(std::string const& path);
+
+// reads the cached mip chain of an image file into image. Returns false if there is no valid cache for path and params
+bool LoadCompressedTexture(std::string const& path, TextureParams const& params, TextureImage& image);
+
+// writes the compressed mip chain of an image file to its cache file
+bool SaveCompressedTexture(std::string const& path, TextureParams const& params, TextureImage const& image);
+
+#endif
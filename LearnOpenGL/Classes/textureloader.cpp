@@ -0,0 +1,113 @@
+#include "textureloader.h"
+
+#include "profiler.h"
+#include "stb_image.h"
+#include "texturecompression.h"
+
+#include <iostream>
+
+// decodes an image file with stb_image and builds its mip chain, or reads its compressed mip chain from the cache
+TextureImage DecodeTexture(std::string const& path, TextureParams const& params)
+{
+    PROFILE_SCOPE("DecodeTexture");
+    TextureImage image;
+    image.path = path;
+    if (params.compress && LoadCompressedTexture(path, params, image))
+        return image;
+
+    // per thread setting, workers may decode with different parameters at the same time
+    stbi_set_flip_vertically_on_load_thread(params.flipVertically);
+    unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+    if (!data)
+        return image;
+
+    // the mip chain is built here on the worker instead of by glGenerateMipmap on the GL thread
+    GenerateMipChain(data, image.width, image.height, image.nrComponents, params.mipmapMode, image.levels, image.levelData);
+    stbi_image_free(data);
+
+    if (params.compress)
+    {
+        CompressTexture(image);
+        SaveCompressedTexture(path, params, image);
+    }
+    return image;
+}
+
+// pixel transfer format of images with nrComponents channels
+GLenum TextureFormat(int nrComponents)
+{
+    if (nrComponents == 1)
+        return GL_RED;
+    if (nrComponents == 2)
+        return GL_RG;
+    if (nrComponents == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+// sized internal format of images with nrComponents channels
+GLenum TextureInternalFormat(int nrComponents)
+{
+    if (nrComponents == 1)
+        return GL_R8;
+    if (nrComponents == 2)
+        return GL_RG8;
+    if (nrComponents == 3)
+        return GL_RGB8;
+    return GL_RGBA8;
+}
+
+// repeat wrapping and trilinear filtering of the bound GL_TEXTURE_2D
+void SetTextureSampling()
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// GPU memory of a texture with its full mip chain
+size_t TextureBytes(TextureImage const& image)
+{
+    return image.levelData.size();
+}
+
+// GPU memory of a texture, and what it would take uncompressed
+TextureMemory TextureMemoryOf(TextureImage const& image)
+{
+    size_t uncompressed = 0;
+    for (MipLevel const& level : image.levels)
+        uncompressed += static_cast<size_t>(level.width) * level.height * image.nrComponents;
+    return TextureMemory{ TextureBytes(image), uncompressed };
+}
+
+// uploads the mip chain into textureID and frees it
+TextureMemory UploadTexture(unsigned int textureID, TextureImage& image)
+{
+    if (image.levels.empty())
+    {
+        std::cout << "Texture failed to load at path: " << image.path << std::endl;
+        return TextureMemory{ 0, 0 };
+    }
+
+    GLenum format = TextureFormat(image.nrComponents);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    // rows of RGB levels are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level < image.levels.size(); level++)
+    {
+        MipLevel const& mip = image.levels[level];
+        unsigned char const* pixels = image.levelData.data() + mip.offset;
+        if (image.compressedFormat != 0)
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), image.compressedFormat, mip.width, mip.height, 0,
+                static_cast<GLsizei>(mip.size), pixels);
+        else
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    SetTextureSampling();
+
+    TextureMemory memory = TextureMemoryOf(image);
+    std::vector<unsigned char>().swap(image.levelData);
+    return memory;
+}
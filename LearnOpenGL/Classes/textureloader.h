@@ -0,0 +1,60 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <glad/glad.h>
+
+#include "mipmaps.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// parameters that change the texture created from an image file
+struct TextureParams {
+    bool flipVertically = true;
+    // color space the mip chain is built in, see mipmaps.h
+    MipmapMode mipmapMode = MIPMAP_LINEAR;
+    // block compress the mip chain (see texturecompression.h), cached next to the image file
+    bool compress = false;
+};
+
+// decoded mip chain of an image file, waiting to be uploaded to the GPU. levels is empty if decoding failed
+struct TextureImage {
+    int width = 0;
+    int height = 0;
+    int nrComponents = 0; // of the image file, also for compressed images
+    std::string path;
+
+    // full mip chain, finest level first, in the block format compressedFormat or (0) as pixels of nrComponents
+    // bytes
+    GLenum compressedFormat = 0;
+    std::vector<MipLevel> levels;
+    std::vector<unsigned char> levelData;
+};
+
+// decodes an image file with stb_image and builds its mip chain, or with params.compress reads its compressed mip
+// chain from the cache (creating the cache on a miss). Touches no GL state, so it is safe to call from worker threads
+TextureImage DecodeTexture(std::string const& path, TextureParams const& params = TextureParams());
+
+// pixel transfer format and sized internal format of images with nrComponents channels
+GLenum TextureFormat(int nrComponents);
+GLenum TextureInternalFormat(int nrComponents);
+
+// repeat wrapping and trilinear filtering of the bound GL_TEXTURE_2D, as every model texture uses
+void SetTextureSampling();
+
+// GPU memory of a texture with its full mip chain, and what the same texture would take uncompressed
+struct TextureMemory {
+    size_t resident;
+    size_t uncompressed;
+};
+
+// GPU memory of a texture with its full mip chain
+size_t TextureBytes(TextureImage const& image);
+TextureMemory TextureMemoryOf(TextureImage const& image);
+
+// uploads the mip chain of an image into textureID and frees it. GL thread only. Returns the GPU memory used by the
+// texture including its mip chain
+TextureMemory UploadTexture(unsigned int textureID, TextureImage& image);
+
+#endif
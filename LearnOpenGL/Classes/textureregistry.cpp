@@ -0,0 +1,121 @@
+#include "textureregistry.h"
+#include "bindlesstextures.h"
+
+#include <filesystem>
+#include <unordered_map>
+
+namespace
+{
+    struct TextureEntry {
+        unsigned int id;
+        unsigned int refCount;
+        TextureMemory memory;
+        bool uploaded;
+        std::string key;
+    };
+
+    // key -> entry and texture ID -> key, both O(1)
+    std::unordered_map<std::string, TextureEntry> entries;
+    std::unordered_map<unsigned int, std::string> keysById;
+
+    size_t bytesResident = 0;
+    size_t bytesUncompressed = 0;
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+
+    // canonical absolute path plus every load parameter that changes the resulting texture
+    std::string makeKey(std::string const& path, TextureParams const& params)
+    {
+        std::error_code ec;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(std::filesystem::absolute(path, ec), ec);
+        std::string key = ec ? path : canonical.generic_string();
+        key += params.flipVertically ? "|flip" : "|noflip";
+        if (params.mipmapMode == MIPMAP_SRGB)
+            key += "|srgb";
+        else if (params.mipmapMode == MIPMAP_NORMALS)
+            key += "|normals";
+        if (params.compress)
+            key += "|bc";
+        return key;
+    }
+}
+
+// looks up the texture of an image file, creating an empty texture object on a miss
+bool TextureRegistry::Acquire(std::string const& path, TextureParams const& params, unsigned int& textureID)
+{
+    std::string key = makeKey(path, params);
+
+    auto found = entries.find(key);
+    if (found != entries.end())
+    {
+        found->second.refCount++;
+        textureID = found->second.id;
+        hits++;
+        return true;
+    }
+
+    glGenTextures(1, &textureID);
+    entries[key] = TextureEntry{ textureID, 1, TextureMemory{ 0, 0 }, false, key };
+    keysById[textureID] = key;
+    misses++;
+    return false;
+}
+
+// records the GPU memory a texture occupies once its pixels are uploaded
+void TextureRegistry::SetMemory(unsigned int textureID, TextureMemory const& memory)
+{
+    auto key = keysById.find(textureID);
+    if (key == keysById.end())
+        return;
+
+    TextureEntry& entry = entries[key->second];
+    bytesResident = bytesResident - entry.memory.resident + memory.resident;
+    bytesUncompressed = bytesUncompressed - entry.memory.uncompressed + memory.uncompressed;
+    entry.memory = memory;
+    // a failed decode uploads nothing and leaves the texture without storage
+    entry.uploaded = memory.resident > 0;
+}
+
+// GPU memory of a texture
+TextureMemory TextureRegistry::Memory(unsigned int textureID)
+{
+    auto key = keysById.find(textureID);
+    if (key == keysById.end())
+        return TextureMemory{ 0, 0 };
+    return entries[key->second].memory;
+}
+
+// true once the texture's upload was recorded, or if the registry does not own it
+bool TextureRegistry::IsUploaded(unsigned int textureID)
+{
+    auto key = keysById.find(textureID);
+    if (key == keysById.end())
+        return true;
+    return entries[key->second].uploaded;
+}
+
+// drops a reference, deleting the texture once no one uses it any more
+bool TextureRegistry::Release(unsigned int textureID)
+{
+    auto key = keysById.find(textureID);
+    if (key == keysById.end())
+        return false;
+
+    auto entry = entries.find(key->second);
+    if (--entry->second.refCount > 0)
+        return false;
+
+    bytesResident -= entry->second.memory.resident;
+    bytesUncompressed -= entry->second.memory.uncompressed;
+    ReleaseTextureHandle(textureID);
+    glDeleteTextures(1, &textureID);
+    entries.erase(entry);
+    keysById.erase(key);
+    return true;
+}
+
+// current counters
+TextureRegistryStats TextureRegistry::Stats()
+{
+    return TextureRegistryStats{ entries.size(), bytesResident, bytesUncompressed, hits, misses };
+}
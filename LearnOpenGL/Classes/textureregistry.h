@@ -0,0 +1,45 @@
+#ifndef TEXTUREREGISTRY_H
+#define TEXTUREREGISTRY_H
+
+#include "textureloader.h"
+
+#include <cstddef>
+#include <string>
+
+// registry counters, e.g. for the stats window
+struct TextureRegistryStats {
+    size_t entries;
+    size_t bytesResident;
+    size_t bytesUncompressed; // bytesResident if every texture was uncompressed
+    unsigned int hits;
+    unsigned int misses;
+};
+
+// Process-wide table of loaded textures shared by every Model, so a file referenced by several models is
+// decoded and uploaded once. Entries are keyed by canonical absolute path plus load parameters and are
+// reference counted. Must only be used from the GL thread.
+class TextureRegistry
+{
+public:
+    // looks up the texture of an image file. On a hit a reference is added and true is returned. On a miss a
+    // new texture object holding one reference is created and false is returned; the caller has to upload it
+    static bool Acquire(std::string const& path, TextureParams const& params, unsigned int& textureID);
+
+    // records the GPU memory a texture occupies once its pixels are uploaded
+    static void SetMemory(unsigned int textureID, TextureMemory const& memory);
+
+    // GPU memory of a texture, zero while it is not uploaded
+    static TextureMemory Memory(unsigned int textureID);
+
+    // true once SetMemory recorded a texture's upload with storage, or if the registry does not own the texture.
+    // Until then its storage and sampling state may still change, so no bindless handle may be created for it
+    static bool IsUploaded(unsigned int textureID);
+
+    // drops a reference, deleting the texture once no one uses it any more. Returns true if it was deleted
+    static bool Release(unsigned int textureID);
+
+    // current counters
+    static TextureRegistryStats Stats();
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include "texturestreamer.h"
+#include "profiler.h"
+#include "textureregistry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// constructor, ringSize bytes of staging memory and at most bytesPerFrame staged per Update
+TextureStreamer::TextureStreamer(size_t ringSize, size_t bytesPerFrame)
+{
+    this->ringSize = ringSize;
+    this->bytesPerFrame = bytesPerFrame;
+    head = 0;
+    used = 0;
+    unfenced = 0;
+    stats = TextureStreamerStats{ 0, 0, 0, 0, 0 };
+
+    // immutable storage that stays mapped for the lifetime of the streamer
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ringSize, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringSize, flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// drops the textures still queued, deletes the fences, unmaps and deletes the ring
+TextureStreamer::~TextureStreamer()
+{
+    while (!queue.empty())
+        Cancel(queue.front().id);
+    for (RingSegment const& segment : segments)
+        glDeleteSync(segment.fence);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+}
+
+// queues the mip chain of textureID, decoded now or by a worker
+void TextureStreamer::Queue(unsigned int textureID, std::future<TextureImage> image)
+{
+    PendingTexture texture;
+    texture.id = textureID;
+    texture.decoding = std::move(image);
+    texture.decoded = false;
+    texture.rowsUploaded = 0;
+    texture.levelsUploaded = 0;
+    queue.push_back(std::move(texture));
+}
+
+void TextureStreamer::Queue(unsigned int textureID, TextureImage image)
+{
+    std::promise<TextureImage> decoded;
+    decoded.set_value(std::move(image));
+    Queue(textureID, decoded.get_future());
+}
+
+// drops a queued texture
+void TextureStreamer::Cancel(unsigned int textureID)
+{
+    auto found = std::find_if(queue.begin(), queue.end(), [textureID](PendingTexture const& texture) { return texture.id == textureID; });
+    if (found == queue.end())
+        return;
+
+    // a decoding job still running finishes on its worker, its mip chain is freed with the discarded result
+    queue.erase(found);
+}
+
+// stages and uploads up to bytesPerFrame of the queued textures
+void TextureStreamer::Update()
+{
+    PROFILE_SCOPE("TextureStreamer::Update");
+    retire(false);
+    if (!upload(bytesPerFrame))
+        stats.ringFullFrames++;
+}
+
+// uploads everything queued now, waiting for decoding jobs and ring space as needed
+void TextureStreamer::Finish()
+{
+    while (!queue.empty())
+    {
+        bool ringFull = !upload(SIZE_MAX);
+        if (queue.empty())
+            break;
+
+        // no progress possible until the GPU frees ring space or a worker finishes decoding
+        if (ringFull)
+            retire(true);
+        else
+        {
+            for (PendingTexture& texture : queue)
+                if (!texture.decoded)
+                {
+                    texture.decoding.wait();
+                    break;
+                }
+        }
+    }
+}
+
+// true while textures are queued
+bool TextureStreamer::Busy() const
+{
+    return !queue.empty();
+}
+
+TextureStreamerStats TextureStreamer::Stats() const
+{
+    TextureStreamerStats current = stats;
+    current.pending = static_cast<unsigned int>(queue.size());
+    current.bytesPending = 0;
+    for (PendingTexture const& texture : queue)
+    {
+        TextureImage const& image = texture.image;
+        if (!texture.decoded)
+            continue;
+        // the levels still to upload are the finest ones, at the front of the chain
+        MipLevel const& next = image.levels[image.levels.size() - 1 - texture.levelsUploaded];
+        current.bytesPending += next.offset + next.size - levelRowBytes(image, next) * texture.rowsUploaded;
+    }
+    return current;
+}
+
+// stages and uploads up to budget bytes, returns false when the ring ran out of space
+bool TextureStreamer::upload(size_t budget)
+{
+    size_t staged = 0;
+    bool ringFull = false;
+
+    // rows of RGB images are not 4 byte aligned
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    auto texture = queue.begin();
+    while (texture != queue.end() && staged < budget)
+    {
+        // textures still decoding are skipped, later ones may be ready
+        if (!texture->decoded)
+        {
+            if (texture->decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++texture;
+                continue;
+            }
+            texture->image = texture->decoding.get();
+            texture->decoded = true;
+            if (texture->image.levels.empty())
+            {
+                std::cout << "Texture failed to load at path: " << texture->image.path << std::endl;
+                texture = queue.erase(texture);
+                continue;
+            }
+        }
+
+        if (!uploadLevel(*texture, budget - staged, staged))
+        {
+            ringFull = true;
+            break;
+        }
+
+        if (texture->levelsUploaded == static_cast<int>(texture->image.levels.size()))
+        {
+            TextureRegistry::SetMemory(texture->id, finishTexture(*texture));
+            stats.completed++;
+            texture = queue.erase(texture);
+        }
+    }
+
+    // set back to default
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // the uploads above read the ring space until the GPU passes this fence
+    if (unfenced > 0)
+    {
+        segments.push_back(RingSegment{ unfenced, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+        unfenced = 0;
+    }
+    stats.bytesLastFrame = staged;
+    return !ringFull;
+}
+
+// frees the ring space of every segment the GPU is done with, waiting for the oldest one if wait is set
+void TextureStreamer::retire(bool wait)
+{
+    while (!segments.empty())
+    {
+        GLenum result = glClientWaitSync(segments.front().fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            if (wait && result == GL_TIMEOUT_EXPIRED)
+                continue;
+            break;
+        }
+        glDeleteSync(segments.front().fence);
+        used -= segments.front().bytes;
+        segments.pop_front();
+        wait = false;
+    }
+    if (used == 0)
+        head = 0;
+}
+
+// stages and uploads the next band of rows of a texture's mip chain, coarsest level first
+bool TextureStreamer::uploadLevel(PendingTexture& texture, size_t maxBytes, size_t& staged)
+{
+    TextureImage const& image = texture.image;
+    GLint level = static_cast<GLint>(image.levels.size()) - 1 - texture.levelsUploaded;
+    MipLevel const& mip = image.levels[level];
+
+    // a band of whole rows (of blocks for compressed levels), at least one even when it exceeds maxBytes
+    size_t rowBytes = levelRowBytes(image, mip);
+    int rowCount = static_cast<int>(mip.size / rowBytes);
+    size_t remaining = (rowCount - texture.rowsUploaded) * rowBytes;
+    size_t offset;
+    size_t bytes = allocate(rowBytes, std::min(remaining, std::max(maxBytes, rowBytes)), offset);
+    if (bytes == 0)
+        return false;
+
+    if (texture.levelsUploaded == 0 && texture.rowsUploaded == 0)
+        allocateStorage(texture);
+    int rows = static_cast<int>(bytes / rowBytes);
+    std::memcpy(mapped + offset, image.levelData.data() + mip.offset + texture.rowsUploaded * rowBytes, bytes);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    if (image.compressedFormat != 0)
+    {
+        int y = texture.rowsUploaded * 4;
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, mip.width, std::min(rows * 4, mip.height - y), image.compressedFormat,
+            static_cast<GLsizei>(bytes), reinterpret_cast<void*>(offset));
+    }
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, texture.rowsUploaded, mip.width, rows, TextureFormat(image.nrComponents),
+            GL_UNSIGNED_BYTE, reinterpret_cast<void*>(offset));
+    texture.rowsUploaded += rows;
+    staged += bytes;
+
+    // sample the finest level uploaded so far
+    if (texture.rowsUploaded == rowCount)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        texture.levelsUploaded++;
+        texture.rowsUploaded = 0;
+    }
+    return true;
+}
+
+// bytes of one row of pixels, or of 4x4 blocks for compressed images, of a mip level
+size_t TextureStreamer::levelRowBytes(TextureImage const& image, MipLevel const& level)
+{
+    if (image.compressedFormat != 0)
+        return level.size / ((level.height + 3) / 4);
+    return static_cast<size_t>(level.width) * image.nrComponents;
+}
+
+// up to maxBytes (at least minBytes) of contiguous ring space, wrapping around if the end is too short
+size_t TextureStreamer::allocate(size_t minBytes, size_t maxBytes, size_t& offset)
+{
+    // the free space starts at head and may wrap around the end of the ring
+    size_t available = ringSize - used;
+    size_t atHead = std::min(ringSize - head, available);
+    if (atHead < minBytes && available > ringSize - head)
+    {
+        // skip the short end, it is freed together with this frame's segment
+        size_t skipped = ringSize - head;
+        used += skipped;
+        unfenced += skipped;
+        available -= skipped;
+        head = 0;
+        atHead = available;
+    }
+
+    size_t bytes = std::min(maxBytes, atHead) / minBytes * minBytes;
+    if (bytes == 0)
+        return 0;
+    offset = head;
+    head = (head + bytes) % ringSize;
+    used += bytes;
+    unfenced += bytes;
+    return bytes;
+}
+
+// allocates storage for the full mip chain of a texture
+void TextureStreamer::allocateStorage(PendingTexture const& texture)
+{
+    // uploaded coarsest first, uploadLevel moves the base level down as the finer levels arrive
+    TextureImage const& image = texture.image;
+    GLsizei levels = static_cast<GLsizei>(image.levels.size());
+    GLenum internalFormat = image.compressedFormat != 0 ? image.compressedFormat : TextureInternalFormat(image.nrComponents);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, image.width, image.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+}
+
+// samples every level, sets the sampling parameters and frees the mip chain of a finished texture
+TextureMemory TextureStreamer::finishTexture(PendingTexture& texture)
+{
+    TextureImage& image = texture.image;
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    SetTextureSampling();
+
+    TextureMemory memory = TextureMemoryOf(image);
+    std::vector<unsigned char>().swap(image.levelData);
+    return memory;
+}
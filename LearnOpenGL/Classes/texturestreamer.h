@@ -0,0 +1,111 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <glad/glad.h>
+
+#include "textureloader.h"
+
+#include <cstddef>
+#include <deque>
+#include <future>
+
+// streamer counters, e.g. for the stats window
+struct TextureStreamerStats {
+    unsigned int pending;       // textures queued or partly uploaded
+    size_t bytesPending;        // mip chain bytes still to upload of the decoded ones
+    size_t bytesLastFrame;      // bytes staged by the last Update
+    unsigned int completed;     // textures fully uploaded since the start
+    unsigned int ringFullFrames; // Updates that stopped early because the staging ring was full
+};
+
+// Uploads decoded textures over several frames instead of in one blocking glTexImage2D each. Pixels are copied
+// into a persistently mapped pixel unpack buffer used as a ring and uploaded from there with glTexSubImage2D, a
+// band of rows at a time, at most bytesPerFrame per Update. Every Update fences the ring space it used; the space
+// is reused once the GPU has passed the fence, so staging never waits for the GPU and never overwrites pixels
+// a pending upload still reads. A texture gets immutable storage for its full mip chain (see mipmaps.h), block
+// compressed or not, when its first band is uploaded. The chain is uploaded coarsest level first, with
+// GL_TEXTURE_BASE_LEVEL following the finest level completed so far, so textures come up blurry and sharpen.
+// Must only be used from the GL thread.
+class TextureStreamer
+{
+public:
+    // constructor, ringSize bytes of staging memory and at most bytesPerFrame staged per Update
+    TextureStreamer(size_t ringSize = 64 * 1024 * 1024, size_t bytesPerFrame = 8 * 1024 * 1024);
+
+    // drops the textures still queued, deletes the fences, unmaps and deletes the ring, so the GL context must
+    // still be current
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // queues the mip chain of textureID, decoded now or by a worker. Decoding jobs are picked up once they finish
+    void Queue(unsigned int textureID, std::future<TextureImage> image);
+    void Queue(unsigned int textureID, TextureImage image);
+
+    // drops a queued texture, e.g. because it was deleted before its upload finished
+    void Cancel(unsigned int textureID);
+
+    // stages and uploads up to bytesPerFrame of the queued textures, called once per frame
+    void Update();
+
+    // uploads everything queued now, waiting for decoding jobs and ring space as needed
+    void Finish();
+
+    // true while textures are queued
+    bool Busy() const;
+
+    TextureStreamerStats Stats() const;
+
+private:
+    struct PendingTexture {
+        unsigned int id;
+        std::future<TextureImage> decoding;
+        TextureImage image;
+        bool decoded;
+        int rowsUploaded;   // of the level being uploaded, in rows of blocks for compressed levels
+        int levelsUploaded;
+    };
+
+    // ring space used by one Update, free again once the GPU passed its fence
+    struct RingSegment {
+        size_t bytes;
+        GLsync fence;
+    };
+
+    unsigned int buffer;
+    unsigned char* mapped;
+    size_t ringSize;
+    size_t bytesPerFrame;
+    size_t head;
+    size_t used;
+    size_t unfenced; // ring space used since the last fence
+    std::deque<RingSegment> segments;
+    std::deque<PendingTexture> queue;
+    TextureStreamerStats stats;
+
+    // stages and uploads up to budget bytes, returns false when the ring ran out of space
+    bool upload(size_t budget);
+
+    // frees the ring space of every segment the GPU is done with, waiting for the oldest one if wait is set
+    void retire(bool wait);
+
+    // stages and uploads the next band of rows of a texture's mip chain, coarsest level first, up to maxBytes.
+    // Returns false when the ring ran out of space
+    bool uploadLevel(PendingTexture& texture, size_t maxBytes, size_t& staged);
+
+    // bytes of one row of pixels, or of 4x4 blocks for compressed images, of a mip level
+    static size_t levelRowBytes(TextureImage const& image, MipLevel const& level);
+
+    // up to maxBytes (at least minBytes) of contiguous ring space, wrapping around if the end is too short.
+    // Returns the bytes reserved at offset, 0 when the ring is too full
+    size_t allocate(size_t minBytes, size_t maxBytes, size_t& offset);
+
+    // allocates storage for the full mip chain of a texture
+    static void allocateStorage(PendingTexture const& texture);
+
+    // samples every level, sets the sampling parameters and frees the mip chain of a finished texture
+    static TextureMemory finishTexture(PendingTexture& texture);
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "threadpool.h"
+
+// constructor, starts threadCount worker threads (at least one)
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    stopping = false;
+    if (threadCount == 0)
+        threadCount = 1;
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+// finishes all queued jobs and joins the workers
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// number of worker threads
+unsigned int ThreadPool::Size() const
+{
+    return static_cast<unsigned int>(workers.size());
+}
+
+// worker thread main loop
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
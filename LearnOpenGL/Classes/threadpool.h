@@ -0,0 +1,55 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // constructor, starts threadCount worker threads (at least one)
+    ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+
+    // finishes all queued jobs and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queues a job for the workers. The returned future holds the job's result
+    template <typename F>
+    auto Enqueue(F&& job) -> std::future<decltype(job())>
+    {
+        using Result = decltype(job());
+        // std::function needs a copyable callable, so the task is shared
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+    // number of worker threads
+    unsigned int Size() const;
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+
+    // worker thread main loop
+    void workerLoop();
+};
+
+#endif
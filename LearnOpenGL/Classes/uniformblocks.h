@@ -0,0 +1,60 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// C++ mirrors of the std140 uniform blocks declared in shader.vert / shader.frag. Every program that declares
+// a block with the same binding reads the same data, so it is written once per frame no matter how many
+// programs there are. vec3 members are followed by a float (or padding) to match std140's 16 byte alignment.
+
+const unsigned int CAMERA_BLOCK_BINDING = 0;
+const unsigned int LIGHTS_BLOCK_BINDING = 1;
+
+// layout (std140, binding = 0) uniform Camera
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float padding;
+};
+
+struct DirLightBlock {
+    glm::vec3 direction;
+    float padding0;
+    glm::vec3 ambient;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 specular;
+    float padding3;
+};
+
+struct PointLightBlock {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding;
+};
+
+// layout (std140, binding = 1) uniform Lights
+struct LightsBlock {
+    DirLightBlock dirLight;
+    PointLightBlock pointLight;
+};
+
+// both blocks share one slot of the frame's uniform ring. The GL spec caps GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT at
+// 256, so the Lights block starting at 256 is correctly aligned on every implementation
+const size_t LIGHTS_BLOCK_OFFSET = 256;
+const size_t FRAME_UNIFORMS_SIZE = LIGHTS_BLOCK_OFFSET + sizeof(LightsBlock);
+
+static_assert(sizeof(CameraBlock) <= LIGHTS_BLOCK_OFFSET, "CameraBlock overlaps the Lights block");
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock does not match the std140 Camera block");
+static_assert(sizeof(LightsBlock) == 128, "LightsBlock does not match the std140 Lights block");
+
+#endif
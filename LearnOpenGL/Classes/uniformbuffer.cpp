@@ -0,0 +1,63 @@
+#include "uniformbuffer.h"
+
+// constructor, slotSize bytes per frame (rounded up to the uniform buffer offset alignment)
+UniformBufferRing::UniformBufferRing(size_t slotSize, unsigned int frameCount)
+{
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    size_t alignment = static_cast<size_t>(offsetAlignment);
+    this->slotSize = (slotSize + alignment - 1) / alignment * alignment;
+    current = frameCount - 1;
+    fences.assign(frameCount, nullptr);
+
+    // immutable storage that stays mapped for the lifetime of the ring
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, this->slotSize * frameCount, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, this->slotSize * frameCount, flags));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// deletes the fences, unmaps and deletes the buffer
+UniformBufferRing::~UniformBufferRing()
+{
+    for (GLsync fence : fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+}
+
+// waits until the GPU is done with the next slot and returns its mapped memory
+unsigned char* UniformBufferRing::BeginFrame()
+{
+    current = (current + 1) % fences.size();
+
+    GLsync& fence = fences[current];
+    if (fence)
+    {
+        // usually already signaled, the slot was last used frameCount frames ago
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    return mapped + current * slotSize;
+}
+
+// binds size bytes at offset inside the current slot to a uniform block binding point
+void UniformBufferRing::BindRange(unsigned int binding, size_t offset, size_t size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, current * slotSize + offset, size);
+}
+
+// fences the current slot after the frame's draw calls were issued
+void UniformBufferRing::EndFrame()
+{
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
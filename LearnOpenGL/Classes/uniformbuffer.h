@@ -0,0 +1,41 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// Persistently mapped uniform buffer split into one slot per frame in flight (triple buffered by default).
+// Each frame the CPU writes the next slot while the GPU may still read the previous ones; fences make sure a
+// slot is never overwritten before the GPU is done with it.
+class UniformBufferRing
+{
+public:
+    // constructor, slotSize bytes per frame (rounded up to the uniform buffer offset alignment)
+    UniformBufferRing(size_t slotSize, unsigned int frameCount = 3);
+
+    // deletes the fences, unmaps and deletes the buffer, so the GL context must still be current
+    ~UniformBufferRing();
+
+    UniformBufferRing(const UniformBufferRing&) = delete;
+    UniformBufferRing& operator=(const UniformBufferRing&) = delete;
+
+    // waits until the GPU is done with the next slot and returns its mapped memory
+    unsigned char* BeginFrame();
+
+    // binds size bytes at offset inside the current slot to a uniform block binding point
+    void BindRange(unsigned int binding, size_t offset, size_t size);
+
+    // fences the current slot after the frame's draw calls were issued
+    void EndFrame();
+
+private:
+    unsigned int buffer;
+    unsigned char* mapped;
+    size_t slotSize;
+    unsigned int current;
+    std::vector<GLsync> fences;
+};
+
+#endif
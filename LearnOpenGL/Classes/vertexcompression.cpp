@@ -0,0 +1,139 @@
+#include "vertexcompression.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // maps a unit vector onto the octahedron unfolded into [-1, 1]^2
+    glm::vec2 octEncode(glm::vec3 n)
+    {
+        float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (length == 0.0f)
+            return glm::vec2(0.0f);
+        n /= length;
+
+        glm::vec2 e(n.x, n.y);
+        if (n.z < 0.0f)
+        {
+            e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+            e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        return e;
+    }
+
+    // inverse of octEncode, mirrors octDecode in shader.vert
+    glm::vec3 octDecode(glm::vec2 e)
+    {
+        glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    int16_t toSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    float fromSnorm16(int16_t value)
+    {
+        return std::max(value / 32767.0f, -1.0f);
+    }
+}
+
+// quantizes vertices into the packed layout
+PackedVertices PackVertices(std::vector<Vertex> const& vertices)
+{
+    PackedVertices packed;
+
+    // bounding box, every position is stored relative to it
+    glm::vec3 minimum(0.0f), maximum(0.0f);
+    if (!vertices.empty())
+        minimum = maximum = vertices[0].Position;
+    for (Vertex const& vertex : vertices)
+    {
+        minimum = glm::min(minimum, vertex.Position);
+        maximum = glm::max(maximum, vertex.Position);
+    }
+    packed.offset = minimum;
+    packed.scale = maximum - minimum;
+
+    packed.vertices.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        Vertex const& vertex = vertices[i];
+        PackedVertex& out = packed.vertices[i];
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = packed.scale[axis];
+            float unorm = extent > 0.0f ? (vertex.Position[axis] - minimum[axis]) / extent : 0.0f;
+            out.Position[axis] = static_cast<uint16_t>(std::lround(glm::clamp(unorm, 0.0f, 1.0f) * 65535.0f));
+        }
+        out.padding = 0;
+
+        glm::vec2 octahedral = octEncode(vertex.Normal);
+        out.Normal[0] = toSnorm16(octahedral.x);
+        out.Normal[1] = toSnorm16(octahedral.y);
+
+        out.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+        out.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+    }
+    return packed;
+}
+
+// decodes a packed vertex the same way shader.vert does
+Vertex UnpackVertex(PackedVertex const& vertex, glm::vec3 offset, glm::vec3 scale)
+{
+    Vertex out;
+    glm::vec3 unorm(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+    out.Position = offset + scale * (unorm / 65535.0f);
+    out.Normal = octDecode(glm::vec2(fromSnorm16(vertex.Normal[0]), fromSnorm16(vertex.Normal[1])));
+    out.TexCoords = glm::vec2(glm::unpackHalf1x16(vertex.TexCoords[0]), glm::unpackHalf1x16(vertex.TexCoords[1]));
+    return out;
+}
+
+// packs and decodes vertices again, comparing every attribute against the original
+VertexCompressionError MeasureCompressionError(std::vector<Vertex> const& vertices)
+{
+    PackedVertices packed = PackVertices(vertices);
+
+    VertexCompressionError error = { 0.0f, 0.0f, 0.0f, true };
+    // unorm16 rounding is at most half a step of the box extent, plus float rounding in the decode
+    glm::vec3 positionBound = packed.scale * (0.5f / 65535.0f) + (glm::abs(packed.offset) + packed.scale) * 1e-6f;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        Vertex decoded = UnpackVertex(packed.vertices[i], packed.offset, packed.scale);
+        Vertex const& original = vertices[i];
+
+        glm::vec3 positionError = glm::abs(decoded.Position - original.Position);
+        error.position = std::max(error.position, std::max(positionError.x, std::max(positionError.y, positionError.z)));
+        if (glm::any(glm::greaterThan(positionError, positionBound)))
+            error.withinBounds = false;
+
+        // unit normals only, meshes without normals are all zero
+        float normalLength = glm::length(original.Normal);
+        if (normalLength > 0.0f)
+        {
+            float normalError = glm::length(decoded.Normal - original.Normal / normalLength);
+            error.normal = std::max(error.normal, normalError);
+            // snorm16 octahedral encoding stays well below 1e-4 radians
+            if (normalError > 1e-4f)
+                error.withinBounds = false;
+        }
+
+        for (int axis = 0; axis < 2; axis++)
+        {
+            float texCoordError = std::abs(decoded.TexCoords[axis] - original.TexCoords[axis]);
+            error.texCoords = std::max(error.texCoords, texCoordError);
+            // half floats keep 11 significant bits
+            if (texCoordError > std::abs(original.TexCoords[axis]) * (1.0f / 2048.0f) + 1e-7f)
+                error.withinBounds = false;
+        }
+    }
+    return error;
+}
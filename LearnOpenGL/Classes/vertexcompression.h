@@ -0,0 +1,45 @@
+#ifndef VERTEXCOMPRESSION_H
+#define VERTEXCOMPRESSION_H
+
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 16 byte vertex used by VERTEX_FORMAT_PACKED, half the size of Vertex
+struct PackedVertex {
+    // position as unorm16, relative to the mesh bounding box (see PackedVertices::offset / scale)
+    uint16_t Position[3];
+    uint16_t padding;
+    // octahedral encoded unit normal as snorm16
+    int16_t Normal[2];
+    // texture coordinates as half floats, keeps tiling coordinates outside [0, 1]
+    uint16_t TexCoords[2];
+};
+
+struct PackedVertices {
+    std::vector<PackedVertex> vertices;
+    // position = offset + scale * unorm position, as done in shader.vert
+    glm::vec3 offset;
+    glm::vec3 scale;
+};
+
+// largest decode error per attribute, and whether it stays within the precision the formats guarantee
+struct VertexCompressionError {
+    float position;
+    float normal;
+    float texCoords;
+    bool withinBounds;
+};
+
+// quantizes vertices into the packed layout
+PackedVertices PackVertices(std::vector<Vertex> const& vertices);
+
+// decodes a packed vertex the same way shader.vert does
+Vertex UnpackVertex(PackedVertex const& vertex, glm::vec3 offset, glm::vec3 scale);
+
+// packs and decodes vertices again, comparing every attribute against the original
+VertexCompressionError MeasureCompressionError(std::vector<Vertex> const& vertices);
+
+#endif
@@ -0,0 +1,174 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+out vec4 FragColor;
+
+// shader.frag with the material textures taken from bindless handles, see IndirectRenderer
+struct Material {
+	float shininess;
+};
+
+// per-draw texture handles written by IndirectRenderer::Flush, see IndirectMaterialData
+struct MaterialHandles {
+	uvec2 diffuse;
+	uvec2 specular;
+};
+
+layout (std430, binding = 1) readonly buffer Materials {
+	MaterialHandles materials[];
+};
+
+struct DirLight {
+	vec3 direction;
+	
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+// member order packs each float behind a vec3 (std140), see uniformblocks.h
+struct PointLight {
+	vec3 position;
+	float constant;
+	vec3 ambient;
+	float linear;
+	vec3 diffuse;
+	float quadratic;
+	vec3 specular;
+};
+
+struct SpotLight{
+	vec3 position;
+	vec3 direction;
+	float cutOff;
+	float outerCutOff;
+
+	float constant;
+	float linear;
+	float quadratic;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+#define NR_POINT_LIGHTS 4
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in int DrawIndex;
+
+// per-frame data shared by every program, written once per frame
+layout (std140, binding = 0) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
+
+layout (std140, binding = 1) uniform Lights {
+	DirLight dirLight;
+	PointLight pointLight;
+};
+
+uniform SpotLight spotLight;
+uniform Material material;
+
+// texels of this fragment's material, sampled once in main
+vec3 diffuseTexel;
+vec3 specularTexel;
+
+// function declarations
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+
+
+void main()
+{
+	diffuseTexel = vec3(texture(sampler2D(materials[DrawIndex].diffuse), TexCoords));
+	specularTexel = vec3(texture(sampler2D(materials[DrawIndex].specular), TexCoords));
+
+	vec3 norm = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+
+	// 1: directional lighting
+	vec3 result = CalcDirLight(dirLight, norm, viewDir);
+
+	// 2: Point lights
+	result += CalcPointLight(pointLight, norm, FragPos, viewDir);
+
+	// 3: Spot lights
+	//result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+
+	FragColor = vec4(result, 1.0);
+
+}
+
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+{
+	vec3 lightDir = normalize(-light.direction);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	// combine results
+	vec3 ambient = light.ambient * diffuseTexel;
+	vec3 diffuse = light.diffuse * diff * diffuseTexel;
+	vec3 specular = light.specular * spec * specularTexel;
+
+	return (ambient + diffuse + specular);
+
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	// diffuse
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	// attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	// combine results
+	vec3 ambient = light.ambient * diffuseTexel;
+	vec3 diffuse = light.diffuse * diff * diffuseTexel;
+	vec3 specular = light.specular * spec * specularTexel;
+
+	ambient *= attenuation;
+	diffuse *= attenuation;
+	specular *= attenuation;
+
+	return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	// diffuse
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	// attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	// spotlight intensity
+	float theta = dot(lightDir, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+	// combine results
+	vec3 ambient = light.ambient * diffuseTexel;
+	vec3 diffuse = light.diffuse * diff * diffuseTexel;
+	vec3 specular = light.specular * spec * specularTexel;
+
+	ambient *= attenuation;
+	diffuse *= attenuation;
+	specular *= attenuation;
+
+	return (ambient + diffuse + specular);
+
+}
\ No newline at end of file
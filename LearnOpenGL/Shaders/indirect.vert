@@ -0,0 +1,65 @@
+#version 460 core
+// gl_DrawID is core in 4.6, 4.5 contexts (Shader::SetGlslVersion(450)) have it from ARB_shader_draw_parameters
+#if __VERSION__ >= 460
+#define DRAW_ID gl_DrawID
+#else
+#extension GL_ARB_shader_draw_parameters : require
+#define DRAW_ID gl_DrawIDARB
+#endif
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+flat out int DrawIndex; // material index for bindless.frag
+
+// per-draw data written by IndirectRenderer::Flush, see IndirectDrawData
+struct DrawData {
+	mat4 model;
+	mat3 normalMatrix; // std430: three vec4 aligned columns
+	vec4 positionOffset; // w: octahedral normals
+	vec4 positionScale;
+};
+
+layout (std430, binding = 0) readonly buffer Draws {
+	DrawData draws[];
+};
+
+// index of the batch's first command, gl_DrawID counts from 0 in every multi draw
+uniform int firstDraw;
+
+// per-frame data shared by every program, written once per frame
+layout (std140, binding = 0) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
+
+// inverse of the octahedral normal encoding in vertexcompression.cpp
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	DrawIndex = firstDraw + DRAW_ID;
+	DrawData draw = draws[DrawIndex];
+	mat4 model = draw.model;
+
+	// packed positions arrive as unorm16 inside the mesh bounding box
+	vec3 position = draw.positionOffset.xyz + draw.positionScale.xyz * aPos;
+	vec3 normal = draw.positionOffset.w != 0.0 ? octDecode(aNormal.xy) : aNormal;
+
+	// Multiply all the transforms by the original coords aPos.
+	gl_Position = projection * view * model * vec4(position, 1.0);
+	FragPos = vec3(model * vec4(position, 1.0));
+	Normal = draw.normalMatrix * normal; // Fixes scaling issues
+	TexCoords = aTexCoords;
+}
@@ -15,15 +15,14 @@ struct DirLight {
 	vec3 specular;
 };
 
+// member order packs each float behind a vec3 (std140), see uniformblocks.h
 struct PointLight {
 	vec3 position;
-
 	float constant;
-	float linear;
-	float quadratic;
-
 	vec3 ambient;
+	float linear;
 	vec3 diffuse;
+	float quadratic;
 	vec3 specular;
 };
 
@@ -48,9 +47,18 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLight;
+// per-frame data shared by every program, written once per frame
+layout (std140, binding = 0) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
+
+layout (std140, binding = 1) uniform Lights {
+	DirLight dirLight;
+	PointLight pointLight;
+};
+
 uniform SpotLight spotLight;
 uniform Material material;
 
@@ -2,20 +2,58 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per-instance data of instanced draws, see InstanceData
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in mat3 aInstanceNormalMatrix;
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// transpose(inverse(mat3(model))), computed once per object by Shader::NormalMatrix
+uniform mat3 normalMatrix;
+// read the model and normal matrix from the instance attributes instead of the model uniform
+uniform bool instanced;
+
+// vertex decoding, see Mesh::setupMesh. Full precision meshes use offset 0 and scale 1
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
+
+// per-frame data shared by every program, written once per frame
+layout (std140, binding = 0) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
+
+// inverse of the octahedral normal encoding in vertexcompression.cpp
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main()
 {
+	// packed positions arrive as unorm16 inside the mesh bounding box
+	vec3 position = positionOffset + positionScale * aPos;
+	vec3 normal = octahedralNormals ? octDecode(aNormal.xy) : aNormal;
+
 	// Multiply all the transforms by the original coords aPos.
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
-	FragPos = vec3(model * vec4(aPos, 1.0));
-	Normal = mat3(transpose(inverse(model))) * aNormal; // Fixes scaling issues
+	mat4 world = instanced ? aInstanceModel : model;
+	gl_Position = projection * view * world * vec4(position, 1.0);
+	FragPos = vec3(world * vec4(position, 1.0));
+	// normal matrices come from the CPU, per object or per instance. Fixes scaling issues
+#ifdef PER_VERTEX_NORMAL_MATRIX
+	// reference path for BenchmarkNormalMatrix: a full inverse per vertex
+	Normal = mat3(transpose(inverse(world))) * normal;
+#else
+	Normal = (instanced ? aInstanceNormalMatrix : normalMatrix) * normal;
+#endif
 	TexCoords = aTexCoords;
 }
\ No newline at end of file
@@ -11,9 +11,35 @@
 #include "Classes/stb_image.h"
 #include "Classes/camera.h"
 #include "Classes/model.h"
-
+#include "Classes/meshcache.h"
+#include "Classes/textureregistry.h"
+#include "Classes/geometryarena.h"
+#include "Classes/indirectrenderer.h"
+#include "Classes/bindlesstextures.h"
+#include "Classes/renderqueue.h"
+#include "Classes/frustumculler.h"
+#include "Classes/scenebvh.h"
+#include "Classes/occlusionculler.h"
+#include "Classes/benchmark.h"
+#include "Classes/uniformblocks.h"
+#include "Classes/uniformbuffer.h"
+#include "Classes/headlesscontext.h"
+#include "Classes/offscreentarget.h"
+#include "Classes/profiler.h"
+#include "Classes/camerapath.h"
+#include "Classes/frametimer.h"
+#include "Classes/texturestreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -25,6 +51,10 @@ unsigned int loadTexture(char const* path);
 const int SCR_WIDTH = 1920;
 const int SCR_HEIGHT = 1080;
 
+// time step of headless and --bench-path frames, and the untimed frames before a --bench-path run
+const float FIXED_TIMESTEP = 1.0f / 60.0f;
+const int BENCH_WARMUP_FRAMES = 30;
+
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
@@ -41,43 +71,293 @@ glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
 
 
-int main()
+int main(int argc, char** argv)
 {
+	//----------------------Command line------------------------------------------
+	// --bench-load: time cold (Assimp) against warm (mesh cache) model loads and exit
+	// --bench-decode: time serial against pooled texture decoding and exit (no window needed)
+	// --bench-uniforms: count GL calls (and, built with BENCHMARK_COUNT_ALLOCATIONS, allocations) of the per-frame
+	//   uniform setup and exit
+	// --bench-indirect: compare draw calls, state changes and CPU submit time of per-mesh draws against multi draw
+	//   indirect (with and without bindless textures) and exit
+	// --bench-normals: compare the GPU time of per-vertex normal matrices against the CPU normal matrix and exit
+	// --bench-bvh: compare SceneBvh frustum queries and ray picks against brute force and exit, non-zero if any
+	//   result is wrong (no window needed)
+	// --bench-occlusion: run software occlusion culling on a fixed scene and exit, non-zero if a box is wrongly
+	//   occluded or visible (no window needed)
+	// --packed-vertices: upload meshes in the 16 byte compressed vertex format
+	// --split-16bit: split meshes with more than 65536 vertices so all of them use 16-bit indices
+	// --optimize-meshes: reorder triangles and vertices for the vertex cache on import, prints ACMR/ATVR per mesh
+	// --optimize-overdraw: with --optimize-meshes, also order triangle clusters front to back
+	// --indirect: render the models with one glMultiDrawElementsIndirect per material batch
+	// --bindless: with --indirect, use bindless textures (GL_ARB_bindless_texture) when available
+	// --render-queue: submit the models through a RenderQueue sorted by program, textures, VAO and depth
+	// --instances N: draw N backpacks on a grid with one instanced draw per mesh
+	//   (direct drawing, ignored with --indirect and --render-queue)
+	// --occlusion: skip meshes hidden behind the backpack (or the nearest backpacks of the grid), tested on the CPU
+	// --lods: simplify every mesh into coarser levels of detail on import and pick one per mesh from its screen space error
+	// --meshlets: split meshes into meshlets on import and draw only the clusters inside the frustum (and, with face
+	//   culling enabled, facing the camera)
+	//   (direct drawing without --instances)
+	// --compress-textures: block compress textures with their mip chains (BC1/BC3/BC4/BC5), cached as DDS files next
+	//   to the images, and print the texture memory of every model with and without compression once it is resident
+	// --headless N: no window, render N frames into an offscreen framebuffer of a surfaceless EGL context (works with
+	//   Mesa llvmpipe), write the last one to disk and exit. Benchmarks run headless as well
+	// --headless-output PATH: image written by --headless, binary PPM (default headless.ppm)
+	// --profile: record CPU and GPU scopes from the start, including model loading (the Profiler window can start
+	//   and stop recording as well)
+	// --profile-output PATH: Chrome trace JSON written on exit and by the Profiler window (default profile.json)
+	// --bench-path PATH: replay a camera path file (see CameraPath) or the built-in "orbit" around the backpack with a
+	//   fixed timestep, time the CPU and GPU side of every frame, write min/median/p95/p99 as JSON and exit. Runs
+	//   without a window together with --headless, whose frame count it replaces
+	// --bench-frames N: timed frames of --bench-path, after BENCH_WARMUP_FRAMES untimed ones (default 600)
+	// --bench-output PATH: JSON written by --bench-path (default benchmark.json)
+	// --record-camera PATH: record the camera's flight through the scene and write it as a path file on exit
+	ModelOptions modelOptions;
+	bool benchLoad = false;
+	bool benchDecode = false;
+	bool benchUniforms = false;
+	bool benchIndirect = false;
+	bool benchNormals = false;
+	bool benchBvh = false;
+	bool benchOcclusion = false;
+	bool indirect = false;
+	bool bindless = false;
+	bool renderQueue = false;
+	bool occlusion = false;
+	int instances = 0;
+	int headlessFrames = 0;
+	std::string headlessOutput = "headless.ppm";
+	bool profile = false;
+	std::string profileOutput = "profile.json";
+	std::string benchPath;
+	int benchFrames = 600;
+	std::string benchOutput = "benchmark.json";
+	std::string recordCamera;
+	std::string commandLine;
+	for (int i = 1; i < argc; i++)
+		commandLine += (i > 1 ? " " : "") + std::string(argv[i]);
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--bench-load")
+			benchLoad = true;
+		else if (arg == "--bench-decode")
+			benchDecode = true;
+		else if (arg == "--bench-uniforms")
+			benchUniforms = true;
+		else if (arg == "--bench-indirect")
+			benchIndirect = true;
+		else if (arg == "--bench-normals")
+			benchNormals = true;
+		else if (arg == "--bench-bvh")
+			benchBvh = true;
+		else if (arg == "--bench-occlusion")
+			benchOcclusion = true;
+		else if (arg == "--indirect")
+			indirect = true;
+		else if (arg == "--bindless")
+			bindless = true;
+		else if (arg == "--render-queue")
+			renderQueue = true;
+		else if (arg == "--occlusion")
+			occlusion = true;
+		else if (arg == "--instances" && i + 1 < argc)
+			instances = std::atoi(argv[++i]);
+		else if (arg == "--headless" && i + 1 < argc)
+			headlessFrames = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--headless-output" && i + 1 < argc)
+			headlessOutput = argv[++i];
+		else if (arg == "--profile")
+			profile = true;
+		else if (arg == "--profile-output" && i + 1 < argc)
+			profileOutput = argv[++i];
+		else if (arg == "--bench-path" && i + 1 < argc)
+			benchPath = argv[++i];
+		else if (arg == "--bench-frames" && i + 1 < argc)
+			benchFrames = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--bench-output" && i + 1 < argc)
+			benchOutput = argv[++i];
+		else if (arg == "--record-camera" && i + 1 < argc)
+			recordCamera = argv[++i];
+		else if (arg == "--packed-vertices")
+			modelOptions.vertexFormat = VERTEX_FORMAT_PACKED;
+		else if (arg == "--split-16bit")
+			modelOptions.splitFor16BitIndices = true;
+		else if (arg == "--optimize-meshes")
+			modelOptions.optimizeVertexCache = true;
+		else if (arg == "--optimize-overdraw")
+			modelOptions.optimizeOverdraw = true;
+		else if (arg == "--lods")
+			modelOptions.generateLods = true;
+		else if (arg == "--meshlets")
+			modelOptions.buildMeshlets = true;
+		else if (arg == "--compress-textures")
+			modelOptions.compressTextures = true;
+	}
+	// the grid is only drawn instanced, the indirect renderer and the render queue submit the single backpack
+	if (instances > 0 && (indirect || renderQueue))
+	{
+		std::cout << "--instances is not supported with " << (indirect ? "--indirect" : "--render-queue") << ", drawing one backpack" << std::endl;
+		instances = 0;
+	}
+	bool benchmark = benchLoad || benchUniforms || benchIndirect || benchNormals;
+
+	if (benchDecode)
+	{
+		stbi_set_flip_vertically_on_load(true);
+		BenchmarkTextureDecode({ "Models", "Images" }, std::thread::hardware_concurrency());
+		return 0;
+	}
+	if (benchBvh)
+	{
+		return BenchmarkSceneBvh({ 1000, 10000, 100000 }, 1000) ? 0 : 1;
+	}
+	if (benchOcclusion)
+	{
+		return BenchmarkOcclusion(100) ? 0 : 1;
+	}
+
+	// --bench-path: the path replayed instead of input, the orbit takes exactly the timed frames
+	CameraPath cameraPath;
+	bool replay = !benchPath.empty();
+	if (replay)
+	{
+		if (benchPath == "orbit")
+			cameraPath = CameraPath::Orbit(glm::vec3(0.0f), 6.0f, 2.0f, benchFrames * FIXED_TIMESTEP);
+		else if (!cameraPath.Load(benchPath))
+			return -1;
+	}
+
 	//----------------------GLFW and GLAD initialization--------------------------
-	// Initializes glfw
-	glfwInit();
-	// Tells glfw what version of opengl to use. this case: 4.6 Core
+	// headless: a surfaceless context instead of a window, the scene renders into an offscreen framebuffer
+	bool headless = headlessFrames > 0;
+	HeadlessContext headlessContext;
+	GLFWwindow* window = NULL;
+	GLADloadproc loadProc = (GLADloadproc)glfwGetProcAddress;
 	const char* glsl_version = "#version 460";
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// Create GLFW object. Inlcuding Error checking.
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-	if (window == NULL)
+	if (headless)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
+		if (!headlessContext.Create())
+			return -1;
+		loadProc = (GLADloadproc)HeadlessContext::GetProcAddress;
+	}
+	else
+	{
+		// Initializes glfw
+		glfwInit();
+		// Tells glfw what version of opengl to use. this case: 4.6 Core
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		// Benchmarks only need the context, not a visible window
+		if (benchmark)
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		// Create GLFW object. Inlcuding Error checking.
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		// Use the object window as the current window.
+		glfwMakeContextCurrent(window);
+		// timed runs should not wait for vertical sync
+		if (replay)
+			glfwSwapInterval(0);
+		// Function to change window size when dragging window.
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		// Run every frame the mouse moves
+		glfwSetCursorPosCallback(window, mouse_callback);
+		// Run everytime scrollwheel is moved
+		glfwSetScrollCallback(window, scroll_callback);
 	}
-	// Use the object window as the current window.
-	glfwMakeContextCurrent(window);
-	// Function to change window size when dragging window.
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	// Run every frame the mouse moves
-	glfwSetCursorPosCallback(window, mouse_callback);
-	// Run everytime scrollwheel is moved
-	glfwSetScrollCallback(window, scroll_callback);
 
 	// glad just calls openGL functions in an easier way
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	if (!gladLoadGLLoader(loadProc))
 	{
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
 
+	// 4.5 contexts (llvmpipe) compile the 4.6 shaders as GLSL 450, indirect.vert then needs ARB_shader_draw_parameters
+	if (headless)
+	{
+		std::cout << "HEADLESS::CONTEXT " << glGetString(GL_VERSION) << ", " << glGetString(GL_RENDERER) << std::endl;
+		if (headlessContext.Version() < 46)
+			Shader::SetGlslVersion(450);
+		if (headlessContext.Version() < 46 && indirect && !HasExtension("GL_ARB_shader_draw_parameters"))
+		{
+			std::cout << "GL_ARB_shader_draw_parameters not supported, drawing without --indirect" << std::endl;
+			indirect = false;
+		}
+	}
+
+	// extension entry points glad does not load
+	if (!LoadBindlessTextures(loadProc) && bindless)
+	{
+		std::cout << "GL_ARB_bindless_texture not supported, binding textures per batch" << std::endl;
+		bindless = false;
+	}
+	if (modelOptions.compressTextures && !HasExtension("GL_EXT_texture_compression_s3tc"))
+	{
+		std::cout << "GL_EXT_texture_compression_s3tc not supported, uploading textures uncompressed" << std::endl;
+		modelOptions.compressTextures = false;
+	}
+
 	stbi_set_flip_vertically_on_load(true);
 
+	// without a default framebuffer everything, benchmarks included, draws into the offscreen target
+	std::unique_ptr<OffscreenTarget> offscreen;
+	if (headless)
+	{
+		offscreen = std::make_unique<OffscreenTarget>(SCR_WIDTH, SCR_HEIGHT);
+		offscreen->Bind();
+	}
+
+	// ------------Benchmarks-------------
+	if (benchLoad)
+	{
+		BenchmarkModelLoad({ "Models/backpack/backpack.obj", "Models/chair/chair.obj", "Models/lightbulb/lightbulb.obj" }, 5);
+		glfwTerminate();
+		return 0;
+	}
+	if (benchUniforms)
+	{
+		Shader benchShader("Shaders/shader.vert", "Shaders/shader.frag");
+		BenchmarkUniforms(benchShader, 100, 1000);
+		glfwTerminate();
+		return 0;
+	}
+	if (benchIndirect)
+	{
+		glEnable(GL_DEPTH_TEST);
+		{
+			Shader directShader("Shaders/shader.vert", "Shaders/shader.frag");
+			Shader indirectShader("Shaders/indirect.vert", "Shaders/shader.frag");
+			std::unique_ptr<Shader> bindlessShader;
+			if (BindlessTexturesSupported())
+				bindlessShader = std::make_unique<Shader>("Shaders/indirect.vert", "Shaders/bindless.frag");
+			BenchmarkIndirect({ "Models/backpack/backpack.obj", "Models/chair/chair.obj", "Models/lightbulb/lightbulb.obj" },
+				directShader, indirectShader, bindlessShader.get(), 1024, 100);
+		}
+		glfwTerminate();
+		return 0;
+	}
+	if (benchNormals)
+	{
+		{
+			Shader shader("Shaders/shader.vert", "Shaders/shader.frag");
+			Shader perVertexShader("Shaders/shader.vert", "Shaders/shader.frag", "#define PER_VERTEX_NORMAL_MATRIX\n");
+			// 256 segments: 256 rings of 512 quads, 262144 triangles
+			BenchmarkNormalMatrix(shader, perVertexShader, 256, 10, 100);
+		}
+		glfwTerminate();
+		return 0;
+	}
+
 
 	//------------------------Main OpenGL Functions-------------------------------
 
@@ -86,115 +366,443 @@ int main()
 	// Enable depth buffer (Z index)
 	glEnable(GL_DEPTH_TEST);
 	// Hide cursor
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+	if (window)
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 	// Wireframe
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //GL_LINE
 
-	// -------------Shaders---------------
-	//
-	Shader ourShader("Shaders/shader.vert", "Shaders/shader.frag");
-
-	// --------------Model----------------
-	Model ourModel("Models/backpack/backpack.obj");
-	Model lightbulbModel("Models/lightbulb/lightbulb.obj");
-
-
-	// --------------imgui----------------
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
-	ImGuiIO& io = ImGui::GetIO();
-
-	ImGui_ImplGlfw_InitForOpenGL(window, true);
-	ImGui_ImplOpenGL3_Init(glsl_version);
-
-	ImGui::StyleColorsDark();
-
-
-
-	//------------------------------Render Loop-----------------------------------
-	while (!glfwWindowShouldClose(window))
+	// everything that owns GL objects lives in this scope, so it is destroyed while the context is still current
 	{
-		
-		// calculate deltaTime
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		// Input
-		processInput(window);
-
-		// Sets the color when the color buffer is cleared.
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear color and depth buffer
-
-		// ----------------imgui------------------
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		// -------------Shaders---------------
+		//
+		Shader ourShader("Shaders/shader.vert", "Shaders/shader.frag");
+		// same lighting, per-draw data from a shader storage buffer indexed with gl_DrawID and, in bindless mode,
+		// the material textures from bindless handles
+		Shader indirectShader("Shaders/indirect.vert", bindless ? "Shaders/bindless.frag" : "Shaders/shader.frag");
+		UniformHandle indirectShininessUniform = indirectShader.getUniform("material.shininess");
+		IndirectRenderer indirectRenderer(bindless);
+		RenderQueue drawQueue;
+		// per mesh (or per instance) boxes tested against the view frustum before anything is submitted
+		FrustumCuller culler;
+		// --meshlets: visible meshes are culled again per meshlet, by bounding sphere and, with face culling, normal cone
+		MeshletCuller meshletCuller;
+		// boxes that passed the frustum are tested against a software rasterized depth buffer of the occluders
+		OcclusionCuller occlusionCuller;
+		// nearest grid instances rasterized as occluders for --occlusion
+		const size_t OCCLUDER_INSTANCES = 4;
+		std::vector<std::pair<float, size_t>> occluderCandidates;
+		// every mesh of both models for picking with the left mouse button, the lightbulb's follow the light
+		SceneBvh sceneBvh;
+		std::vector<unsigned int> backpackObjects, lightbulbObjects;
+		std::string picked = "nothing";
+		bool leftPressed = false;
+		// --lods: largest simplification error allowed on screen, in pixels
+		float lodPixelError = 1.0f;
+		// triangles submitted last frame, shown in the stats window
+		size_t trianglesDrawn = 0;
+
+		// resolve the per-draw uniforms once, the render loop only uses the handles
+		UniformHandle shininessUniform = ourShader.getUniform("material.shininess");
+		UniformHandle modelUniform = ourShader.getUniform("model");
+		UniformHandle normalMatrixUniform = ourShader.getUniform("normalMatrix");
+
+		// camera and light data live in std140 uniform blocks shared by every program, written once per frame
+		// into a triple buffered, persistently mapped ring
+		UniformBufferRing frameUniforms(FRAME_UNIFORMS_SIZE);
+
+		// the view only follows the camera while the right mouse button is held
+		glm::mat4 view = camera.GetViewMatrix();
+
+		// --profile records from here on, model loading included
+		Profiler::SetThreadName("Main");
+		Profiler::SetEnabled(profile);
+
+		// --------------Model----------------
+		// textures are decoded on worker threads while the meshes are built
+		ThreadPool decodePool;
+		modelOptions.decodePool = &decodePool;
+		// and uploaded a few MB per frame once the render loop runs, so the first frames come up without waiting for them
+		TextureStreamer textureStreamer;
+		modelOptions.textureStreamer = &textureStreamer;
+		Model ourModel("Models/backpack/backpack.obj", modelOptions);
+		Model lightbulbModel("Models/lightbulb/lightbulb.obj", modelOptions);
+
+		// square grid of backpacks behind the first one for --instances
+		std::vector<glm::mat4> instanceTransforms;
+		int gridSide = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(instances))));
+		for (int i = 0; i < instances; i++)
+			instanceTransforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(4.0f * (i % gridSide), 0.0f, -4.0f * (i / gridSide))));
+		std::vector<glm::mat4> visibleInstances;
+
+
+		// --------------imgui----------------
+		// headless runs have no window to show it in
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+
+		if (window)
+		{
+			ImGui_ImplGlfw_InitForOpenGL(window, true);
+			ImGui_ImplOpenGL3_Init(glsl_version);
+		}
 
-		ImGui::Begin("Demo window");
-		ImGui::SliderFloat("translation", &lightPos.x, -5, 10);
-		ImGui::End();
+		ImGui::StyleColorsDark();
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 
-		// -------------- Lighting ---------------
-		//
+		//------------------------------Render Loop-----------------------------------
+		int frame = 0;
+		int frameLimit = replay ? BENCH_WARMUP_FRAMES + benchFrames : headlessFrames;
+		FrameTimer frameTimer;
+		CameraPath cameraRecording;
+		float recordStart = 0.0f;
+		// headless and timed runs render the same frames every time, so they start with every texture resident
+		if (headless || replay)
+			textureStreamer.Finish();
+		bool textureMemoryReported = false;
+		auto headlessStart = std::chrono::steady_clock::now();
+		while ((!window || !glfwWindowShouldClose(window)) && (frameLimit == 0 || frame < frameLimit))
+		{
+			Profiler::BeginFrame();
+			bool timed = replay && frame >= BENCH_WARMUP_FRAMES;
+			if (timed)
+				frameTimer.Begin();
+
+			// upload the next share of the textures still streaming in
+			textureStreamer.Update();
+			// texture memory of every model, compressed against uncompressed, once the streamer is done
+			if (modelOptions.compressTextures && !textureMemoryReported && !textureStreamer.Busy())
+			{
+				for (auto model : { std::make_pair("backpack", &ourModel), std::make_pair("lightbulb", &lightbulbModel) })
+				{
+					TextureMemory memory = model.second->TextureMemoryUsed();
+					std::cout << "TEXTURES::MEMORY " << model.first << " " << memory.resident / (1024.0 * 1024.0) << " MB ("
+						<< memory.uncompressed / (1024.0 * 1024.0) << " MB uncompressed)" << std::endl;
+				}
+				textureMemoryReported = true;
+			}
+
+			// calculate deltaTime, headless and replayed frames advance by a fixed step so every run renders the same frames
+			float currentFrame = window && !replay ? float(glfwGetTime()) : frame * FIXED_TIMESTEP;
+			deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			// Input
+			if (window)
+				processInput(window);
+
+			// a replayed path overrides whatever input did to the camera, it starts with the first timed frame
+			if (replay)
+				cameraPath.Apply(camera, std::max(frame - BENCH_WARMUP_FRAMES, 0) * FIXED_TIMESTEP);
+			else if (!recordCamera.empty() && (cameraRecording.Keyframes.empty() || currentFrame - recordStart >= cameraRecording.Duration() + 0.1f))
+			{
+				// ten keyframes per second, the spline fills in between
+				if (cameraRecording.Keyframes.empty())
+					recordStart = currentFrame;
+				cameraRecording.Record(camera, currentFrame - recordStart);
+			}
+
+			// Sets the color when the color buffer is cleared.
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear color and depth buffer
+
+			// ----------------imgui------------------
+			if (window)
+			{
+				PROFILE_GPU_SCOPE("ImGui");
+				ImGui_ImplOpenGL3_NewFrame();
+				ImGui_ImplGlfw_NewFrame();
+				ImGui::NewFrame();
+
+				ImGui::Begin("Demo window");
+				ImGui::SliderFloat("translation", &lightPos.x, -5, 10);
+				ImGui::Text("Mesh cache: %u hits, %u misses", MeshCache::Hits, MeshCache::Misses);
+				TextureRegistryStats textureStats = TextureRegistry::Stats();
+				ImGui::Text("Textures: %zu resident (%.1f MB), %u hits, %u misses", textureStats.entries,
+					textureStats.bytesResident / (1024.0 * 1024.0), textureStats.hits, textureStats.misses);
+				if (modelOptions.compressTextures)
+				{
+					TextureMemory backpackMemory = ourModel.TextureMemoryUsed();
+					TextureMemory lightbulbMemory = lightbulbModel.TextureMemoryUsed();
+					ImGui::Text("Compressed: %.1f MB of %.1f MB uncompressed (backpack %.1f MB, lightbulb %.1f MB)",
+						textureStats.bytesResident / (1024.0 * 1024.0), textureStats.bytesUncompressed / (1024.0 * 1024.0),
+						backpackMemory.resident / (1024.0 * 1024.0), lightbulbMemory.resident / (1024.0 * 1024.0));
+				}
+				TextureStreamerStats streamerStats = textureStreamer.Stats();
+				if (streamerStats.pending > 0)
+					ImGui::Text("Streaming: %u textures (%.1f MB decoded) pending, %.1f MB last frame", streamerStats.pending,
+						streamerStats.bytesPending / (1024.0 * 1024.0), streamerStats.bytesLastFrame / (1024.0 * 1024.0));
+				GeometryArenaStats arenaStats = GeometryArena::Stats();
+				ImGui::Text("Picked: %s", picked.c_str());
+				ImGui::Text("Triangles: %zu drawn, backpack %zu at full detail", trianglesDrawn, ourModel.Triangles());
+				if (modelOptions.generateLods)
+					ImGui::SliderFloat("LOD pixel error", &lodPixelError, 0.25f, 16.0f);
+				if (modelOptions.buildMeshlets && meshletCuller.Stats.meshlets > 0)
+					ImGui::Text("Meshlets: %u tested, %u outside the frustum, %u backfacing, %.1f%% of their triangles drawn in %u ranges",
+						meshletCuller.Stats.meshlets, meshletCuller.Stats.frustumCulled, meshletCuller.Stats.backfaceCulled,
+						100.0 * meshletCuller.Stats.trianglesVisible / std::max<size_t>(meshletCuller.Stats.trianglesTested, 1), meshletCuller.Stats.ranges);
+				if (occlusion)
+					ImGui::Text("Occlusion culling: %u occluder triangles, %u of %u tested boxes occluded",
+						occlusionCuller.Stats.occluderTriangles, occlusionCuller.Stats.occluded, occlusionCuller.Stats.tested);
+				ImGui::Text("Frustum culling (%s): %u visible, %u culled", FrustumCuller::InstructionSet(),
+					culler.Stats.visible, culler.Stats.culled);
+				ImGui::Text("Geometry arena: vertices %.1f / %.1f MB, indices %.1f / %.1f MB, %u ranges, %u growths",
+					arenaStats.vertexBytesUsed / (1024.0 * 1024.0), arenaStats.vertexBytesCapacity / (1024.0 * 1024.0),
+					arenaStats.indexBytesUsed / (1024.0 * 1024.0), arenaStats.indexBytesCapacity / (1024.0 * 1024.0),
+					arenaStats.allocations, arenaStats.bufferGrowths);
+				if (indirect)
+					ImGui::Text("Indirect%s: %u commands in %u multi draws", indirectRenderer.UsesBindless() ? " (bindless)" : "",
+						indirectRenderer.Commands, indirectRenderer.DrawCalls);
+				if (renderQueue)
+				{
+					ImGui::Text("Render queue: %u items", drawQueue.Sorted.items);
+					ImGui::Text("  sorted:   %u program, %u texture, %u VAO binds", drawQueue.Sorted.programBinds,
+						drawQueue.Sorted.textureBinds, drawQueue.Sorted.vaoBinds);
+					ImGui::Text("  unsorted: %u program, %u texture, %u VAO binds", drawQueue.Unsorted.programBinds,
+						drawQueue.Unsorted.textureBinds, drawQueue.Unsorted.vaoBinds);
+				}
+				ImGui::End();
+
+				Profiler::DrawWindow(profileOutput.c_str());
+
+				ImGui::Render();
+				ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			}
+
+
+			// ----------- Transformations -----------
+			// 
+			glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+			if (rightPressed || replay)
+				view = camera.GetViewMatrix();
+
+			// -------------- Lighting ---------------
+			//
+			{
+				PROFILE_SCOPE("Uniforms");
+				CameraBlock cameraData;
+				cameraData.view = view;
+				cameraData.projection = projection;
+				cameraData.viewPos = camera.Position;
+
+				LightsBlock lightsData;
+				// direction light
+				lightsData.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+				lightsData.dirLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+				lightsData.dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+				lightsData.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+
+				// point light
+				lightsData.pointLight.position = lightPos;
+				lightsData.pointLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+				lightsData.pointLight.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+				lightsData.pointLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+				lightsData.pointLight.constant = 1.0f;
+				lightsData.pointLight.linear = 0.09f;
+				lightsData.pointLight.quadratic = 0.032f;
+
+				// one write into this frame's slot feeds every program
+				unsigned char* frameSlot = frameUniforms.BeginFrame();
+				std::memcpy(frameSlot, &cameraData, sizeof(CameraBlock));
+				std::memcpy(frameSlot + LIGHTS_BLOCK_OFFSET, &lightsData, sizeof(LightsBlock));
+				frameUniforms.BindRange(CAMERA_BLOCK_BINDING, 0, sizeof(CameraBlock));
+				frameUniforms.BindRange(LIGHTS_BLOCK_BINDING, LIGHTS_BLOCK_OFFSET, sizeof(LightsBlock));
+			}
+
+			// main model and lightbulb transforms
+			glm::mat4 model = glm::mat4(1.0f);
+			model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
+			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
+			glm::mat4 lightbulbTransform = glm::mat4(1.0f);
+			lightbulbTransform = glm::translate(lightbulbTransform, lightPos);
+			lightbulbTransform = glm::scale(lightbulbTransform, glm::vec3(0.3f, 0.3f, 0.3f));
+
+			// cull against the frustum of the view actually used, which only follows the camera while it is steered
+			culler.Clear();
+			size_t modelBounds = 0;
+			if (instances > 0)
+			{
+				BoundingBox instanceBox = ourModel.Bounds();
+				for (glm::mat4 const& transform : instanceTransforms)
+					culler.Add(TransformBox(instanceBox, transform));
+			}
+			else
+				modelBounds = ourModel.AddBounds(culler, model);
+			size_t lightbulbBounds = lightbulbModel.AddBounds(culler, lightbulbTransform);
+			culler.Cull(Frustum::FromMatrix(projection * view));
+
+			// the occluders are the backpack, or with a grid the visible backpacks nearest to the camera
+			if (occlusion)
+			{
+				occlusionCuller.Begin(projection * view);
+				if (instances > 0)
+				{
+					occluderCandidates.clear();
+					for (size_t i = 0; i < instanceTransforms.size(); i++)
+						if (culler.Visible(i))
+							occluderCandidates.push_back(std::make_pair(glm::length(glm::vec3(instanceTransforms[i][3]) - camera.Position), i));
+					size_t occluders = std::min(OCCLUDER_INSTANCES, occluderCandidates.size());
+					std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + occluders, occluderCandidates.end());
+					for (size_t i = 0; i < occluders; i++)
+						ourModel.RasterizeOccluders(occlusionCuller, instanceTransforms[occluderCandidates[i].second]);
+				}
+				else
+					ourModel.RasterizeOccluders(occlusionCuller, model);
+				occlusionCuller.Finish();
+				occlusionCuller.Cull(culler);
+			}
+
+			// the backpack never moves, the lightbulb boxes are refit every frame
+			if (backpackObjects.empty())
+			{
+				ourModel.InsertBounds(sceneBvh, model, backpackObjects);
+				lightbulbModel.InsertBounds(sceneBvh, lightbulbTransform, lightbulbObjects);
+			}
+			else
+				lightbulbModel.UpdateBounds(sceneBvh, lightbulbTransform, lightbulbObjects);
+			sceneBvh.Refit();
+
+			// pick the mesh under the cursor on a left click that ImGui does not want
+			bool leftDown = window && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+			if (leftDown && !leftPressed && !io.WantCaptureMouse && !rightPressed)
+			{
+				double cursorX, cursorY;
+				int width, height;
+				glfwGetCursorPos(window, &cursorX, &cursorY);
+				glfwGetWindowSize(window, &width, &height);
+				glm::vec2 ndc(2.0f * float(cursorX) / width - 1.0f, 1.0f - 2.0f * float(cursorY) / height);
+
+				RayHit hit;
+				picked = "nothing";
+				if (sceneBvh.Raycast(ScreenRay(ndc, projection * view), hit))
+				{
+					auto mesh = std::find(backpackObjects.begin(), backpackObjects.end(), hit.object);
+					if (mesh != backpackObjects.end())
+						picked = "backpack mesh " + std::to_string(mesh - backpackObjects.begin());
+					else
+						picked = "lightbulb mesh " + std::to_string(std::find(lightbulbObjects.begin(), lightbulbObjects.end(), hit.object) - lightbulbObjects.begin());
+					picked += " at " + std::to_string(hit.distance);
+				}
+			}
+			leftPressed = leftDown;
+
+			// levels of detail from the distance to the eye of the view actually used
+			if (modelOptions.generateLods)
+			{
+				glm::vec3 viewPosition = glm::vec3(glm::inverse(view)[3]);
+				float pixelsPerUnit = camera.PixelsPerUnit(static_cast<float>(SCR_HEIGHT));
+				ourModel.SelectLods(model, viewPosition, pixelsPerUnit, lodPixelError);
+				lightbulbModel.SelectLods(lightbulbTransform, viewPosition, pixelsPerUnit, lodPixelError);
+			}
+
+			trianglesDrawn = 0;
+			if (indirect)
+			{
+				// queue both models and draw them in as few multi draws as the materials allow
+				indirectShader.use();
+				indirectShader.setFloat(indirectShininessUniform, 32.0f);
+				trianglesDrawn += ourModel.Submit(indirectRenderer, model, &culler, modelBounds);
+				trianglesDrawn += lightbulbModel.Submit(indirectRenderer, lightbulbTransform, &culler, lightbulbBounds);
+				indirectRenderer.Flush(indirectShader);
+			}
+			else if (renderQueue)
+			{
+				// queue both models, the queue sorts them and skips redundant binds
+				ourShader.use();
+				ourShader.setFloat(shininessUniform, 32.0f);
+				trianglesDrawn += ourModel.Submit(drawQueue, ourShader, model, glm::length(camera.Position - glm::vec3(model[3])), &culler, modelBounds);
+				trianglesDrawn += lightbulbModel.Submit(drawQueue, ourShader, lightbulbTransform, glm::length(camera.Position - lightPos), &culler, lightbulbBounds);
+				drawQueue.Flush();
+			}
+			else
+			{
+				// activate shader
+				ourShader.use();
+				ourShader.setFloat(shininessUniform, 32.0f);
+
+				// draw main model, or a whole grid of them in one instanced draw per mesh
+				if (instances > 0)
+				{
+					// only the instances in view, the culler holds one box per instance
+					visibleInstances.clear();
+					for (size_t i = 0; i < instanceTransforms.size(); i++)
+						if (culler.Visible(i))
+							visibleInstances.push_back(instanceTransforms[i]);
+					trianglesDrawn += ourModel.DrawInstanced(ourShader, visibleInstances.data(), visibleInstances.size());
+				}
+				else if (modelOptions.buildMeshlets)
+				{
+					// the normal cone test follows GL_CULL_FACE, which is left off, so the image matches the other paths
+					meshletCuller.Begin(Frustum::FromMatrix(projection * view), glm::vec3(glm::inverse(view)[3]), glIsEnabled(GL_CULL_FACE) == GL_TRUE);
+					ourShader.setMat4(modelUniform, model);
+					ourShader.setMat3(normalMatrixUniform, Shader::NormalMatrix(model));
+					trianglesDrawn += ourModel.DrawMeshlets(ourShader, meshletCuller, model, &culler, modelBounds);
+				}
+				else
+				{
+					ourShader.setMat4(modelUniform, model);
+					ourShader.setMat3(normalMatrixUniform, Shader::NormalMatrix(model));
+					trianglesDrawn += ourModel.Draw(ourShader, &culler, modelBounds);
+				}
+
+				// draw lightbulb model
+				ourShader.setMat4(modelUniform, lightbulbTransform);
+				ourShader.setMat3(normalMatrixUniform, Shader::NormalMatrix(lightbulbTransform));
+				if (modelOptions.buildMeshlets && instances == 0)
+					trianglesDrawn += lightbulbModel.DrawMeshlets(ourShader, meshletCuller, lightbulbTransform, &culler, lightbulbBounds);
+				else
+					trianglesDrawn += lightbulbModel.Draw(ourShader, &culler, lightbulbBounds);
+			}
+
+			frameUniforms.EndFrame();
+			if (timed)
+				frameTimer.End();
+			Profiler::EndFrame();
+
+			frame++;
+			if (window)
+			{
+				glfwSwapBuffers(window);
+				// Checks for input events.
+				glfwPollEvents();
+			}
+		}
 
-		// activate shader
-		ourShader.use();
-		ourShader.setVec3("viewPos", camera.Position);
-		ourShader.setFloat("material.shininess", 32.0f);
-
-		// direction light
-		ourShader.setVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
-		ourShader.setVec3("dirLight.ambient", glm::vec3(0.05f, 0.05f, 0.05f));
-		ourShader.setVec3("dirLight.diffuse", glm::vec3(0.4f, 0.4f, 0.4f));
-		ourShader.setVec3("dirLight.specular", glm::vec3(0.5f, 0.5f, 0.5f));
-
-		// point light
-		ourShader.setVec3("pointLight.position", lightPos);
-		ourShader.setVec3("pointLight.ambient", glm::vec3(0.05f, 0.05f, 0.05f));
-		ourShader.setVec3("pointLight.diffuse", glm::vec3(0.8f, 0.8f, 0.8f));
-		ourShader.setVec3("pointLight.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-		ourShader.setFloat("pointLight.constant", 1.0f);
-		ourShader.setFloat("pointLight.linear", 0.09f);
-		ourShader.setFloat("pointLight.quadratic", 0.032f);
-
-		// ----------- Transformations -----------
-		// 
-		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		if (rightPressed)
+		// headless: the last frame is the result
+		if (headless)
 		{
-			glm::mat4 view = camera.GetViewMatrix();
-			ourShader.setMat4("view", view);
+			glFinish();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - headlessStart).count();
+			std::cout << "HEADLESS::FRAMES " << frame << " in " << seconds * 1000.0 << " ms (" << seconds * 1000.0 / frame << " ms per frame)" << std::endl;
+			if (!offscreen->WritePPM(headlessOutput))
+				return -1;
+			std::cout << "HEADLESS::OUTPUT " << headlessOutput << std::endl;
 		}
-		ourShader.setMat4("projection", projection);
-		
 
-		// draw main model
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		ourShader.setMat4("model", model);
-		ourModel.Draw(ourShader);
-
-		// draw lightbulb model
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, lightPos);
-		model = glm::scale(model, glm::vec3(0.3f, 0.3f, 0.3f));
-		ourShader.setMat4("model", model);
-		lightbulbModel.Draw(ourShader);
-
-		glfwSwapBuffers(window);
-		// Checks for input events.
-		glfwPollEvents();
+		if (replay)
+		{
+			frameTimer.Finish();
+			FrameTimeStats cpu = FrameTimer::Summarize(frameTimer.CpuMs());
+			FrameTimeStats gpu = FrameTimer::Summarize(frameTimer.GpuMs());
+			std::cout << "BENCHMARK::PATH " << benchPath << ", " << frameTimer.CpuMs().size() << " frames" << std::endl;
+			std::cout << "  CPU ms: min " << cpu.min << ", median " << cpu.median << ", p95 " << cpu.p95 << ", p99 " << cpu.p99 << std::endl;
+			std::cout << "  GPU ms: min " << gpu.min << ", median " << gpu.median << ", p95 " << gpu.p95 << ", p99 " << gpu.p99 << std::endl;
+			if (!frameTimer.WriteJson(benchOutput, benchPath, commandLine, FIXED_TIMESTEP))
+				return -1;
+			std::cout << "BENCHMARK::OUTPUT " << benchOutput << std::endl;
+		}
+		if (!recordCamera.empty())
+			cameraRecording.Save(recordCamera);
+		if (profile)
+			Profiler::WriteChromeTrace(profileOutput);
 	}
 
-	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+	if (window)
+	{
+		ImGui_ImplOpenGL3_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+	}
 	ImGui::DestroyContext();
 	glfwTerminate();
 	return 0;